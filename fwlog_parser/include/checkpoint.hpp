@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_CHECKPOINT_HPP
+#define AVS_CHECKPOINT_HPP
+
+#include <boost/cstdint.hpp>
+#include <chrono>
+#include <string>
+#include "dictionary.hpp"
+
+// how often following saves its progress, in milliseconds
+#define AVS_CHECKPOINT_INTERVAL		1000
+// amount of data preceding the offset the trace is recognized by, in bytes
+#define AVS_CHECKPOINT_PROBE_SIZE	4096
+
+#define AVS_FNV_OFFSET_BASIS		0xcbf29ce484222325ULL
+
+// Progress of following, once the text of all data decoded was written.
+struct checkpoint {
+	uint64_t identity; // hash of the data preceding offset
+	uint64_t offset; // of the first byte not decoded yet
+	uint64_t timestamp; // of the last entry decoded
+	uint64_t output; // amount of text written
+	uint64_t dictionary; // fingerprint of the dictionary used
+};
+
+// FNV-1a of @data continued from @hash.
+uint64_t fnv1a(uint64_t hash, const void *data, size_t len);
+
+// Returns 0 on success, -ENOENT if there is no checkpoint or other
+// negative error code.
+int load_checkpoint(const std::string &path, struct checkpoint &cp);
+// Replaces the checkpoint atomically, there is always either the previous
+// or the new one in place.
+// Returns 0 on success or negative error code.
+int save_checkpoint(const std::string &path, const struct checkpoint &cp);
+
+// Hashes up to AVS_CHECKPOINT_PROBE_SIZE bytes of the trace preceding
+// @offset, trace found shorter than that is reported with -ESPIPE.
+// Returns 0 on success or negative error code.
+int trace_identity(const std::string &path, uint64_t offset, uint64_t &identity);
+
+/*
+ * Hash of everything entries decode with: keys and the text each literal
+ * renders to. Dictionaries built from the same symbol files share it
+ * regardless of the layout they were built with.
+ */
+template <typename LiteralT>
+uint64_t dictionary_fingerprint(const dictionary<LiteralT> &dict)
+{
+	uint64_t sum = 0;
+	std::string tmpl;
+
+	dict.for_each([&](uint32_t lib_id, uint64_t key, const LiteralT &literal) {
+		uint64_t hash = AVS_FNV_OFFSET_BASIS;
+
+		tmpl.clear();
+		write_template(tmpl, dict.strings(), &literal);
+		hash = fnv1a(hash, &lib_id, sizeof(lib_id));
+		hash = fnv1a(hash, &key, sizeof(key));
+		hash = fnv1a(hash, tmpl.data(), tmpl.size());
+		// order independent
+		sum += hash;
+	});
+
+	return sum;
+}
+
+/*
+ * Saves progress of following periodically. Saving is due every
+ * AVS_CHECKPOINT_INTERVAL and is up to the caller, who has to flush the
+ * output first.
+ */
+class checkpointer {
+public:
+	checkpointer(const std::string &p, const std::string &trace, const struct checkpoint &cp)
+		: path(p), tracepath(trace), current(cp),
+		  last_save(std::chrono::steady_clock::now())
+	{
+	}
+
+	// Progress to start from: the one loaded or all zeros.
+	const struct checkpoint &start() const
+	{
+		return current;
+	}
+
+	bool due() const
+	{
+		return std::chrono::steady_clock::now() - last_save >=
+		       std::chrono::milliseconds(AVS_CHECKPOINT_INTERVAL);
+	}
+
+	// Identity of @cp is filled in here.
+	// Returns 0 on success or negative error code.
+	int save(const struct checkpoint &cp);
+
+private:
+	const std::string path;
+	const std::string tracepath;
+	struct checkpoint current;
+	std::chrono::steady_clock::time_point last_save;
+};
+
+#endif
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_CIRCULAR_DUMP_HPP
+#define AVS_CIRCULAR_DUMP_HPP
+
+#include <boost/cstdint.hpp>
+#include <memory>
+#include <string>
+#include "dictionary.hpp"
+#include "itrace_reader.hpp"
+#include "logdump.hpp"
+
+// Chronological extent of the data held by a circular log window.
+struct circular_window {
+	uint64_t size; // of the whole window
+	uint64_t begin; // position of the oldest entry
+	uint64_t length; // may run past the end of the window
+};
+
+/*
+ * Presents the window in chronological order: from its oldest entry to the
+ * end of the window, then from its beginning on. Data is read from the
+ * underlying reader in place, at the positions it is found at, so entries
+ * split by the end of the window are joined back naturally. Offsets keep
+ * counting past the end of the window, subtract its size to locate wrapped
+ * data in the dump.
+ */
+class circular_reader : public itrace_reader {
+public:
+	circular_reader(std::unique_ptr<itrace_reader> reader, const struct circular_window &win);
+
+	virtual int open(const std::string &path) override;
+	virtual int next(const char **data, size_t *len) override;
+
+	virtual uint64_t tell() const override
+	{
+		return offset;
+	}
+
+	virtual void seek(uint64_t off) override
+	{
+		offset = off;
+	}
+
+private:
+	std::unique_ptr<itrace_reader> in;
+	const struct circular_window window;
+	uint64_t offset;
+};
+
+/*
+ * Scans the dump, all of which is a circular log window, for the point the
+ * producer stopped at. Entries are taken as a cycle and the one whose
+ * timestamp steps back the furthest from its predecessor is the oldest.
+ * Data between the end of its predecessor, the newest entry, and the
+ * oldest one is a remnant of an overwritten entry and is left out. So is
+ * the newest entry if it straddles the end of the window. A window that
+ * never wrapped is found to begin at its first entry.
+ * Returns 0 on success or negative error code.
+ */
+template <class EntryT>
+int find_wrap(itrace_reader &in, const dictionary<typename EntryT::literal_type> &dict,
+	      struct circular_window &win)
+{
+	typedef typename EntryT::literal_type LiteralT;
+
+	EntryT entry;
+	bool seen = false;
+	uint64_t first_pos = 0, first_ts = 0;
+	uint64_t prev_end = 0, prev_ts = 0;
+	uint64_t drop = 0, end = 0;
+	int ret;
+
+	win.begin = 0;
+	in.seek(0);
+	ret = scan_logdump<EntryT>(in, [&](char *buf, size_t len, uint64_t base,
+					   size_t &consumed) {
+		return walk_block<EntryT>(buf, len, dict, consumed,
+					  [&](char *ptr, const struct record_index &rec,
+					      const LiteralT *literal) {
+			uint64_t pos = base + rec.pos, ts;
+
+			if (!literal)
+				return 0;
+
+			entry.assign_ptr(ptr);
+			ts = entry.timestamp();
+			if (!seen) {
+				first_pos = pos;
+				first_ts = ts;
+				seen = true;
+			} else if (ts < prev_ts && prev_ts - ts > drop) {
+				drop = prev_ts - ts;
+				win.begin = pos;
+				end = prev_end;
+			}
+			prev_ts = ts;
+			prev_end = pos + EntryT::size((unsigned char)*ptr);
+			return 0;
+		});
+	});
+	if (ret < 0)
+		return ret;
+
+	win.size = in.tell();
+	if (!seen) {
+		win.length = 0;
+		return 0;
+	}
+
+	// close the cycle: from the last entry back to the first one
+	if (first_ts <= prev_ts && prev_ts - first_ts >= drop) {
+		win.begin = first_pos;
+		end = prev_end;
+	}
+
+	if (end > win.begin)
+		win.length = end - win.begin;
+	else
+		win.length = win.size - (win.begin - end);
+	return 0;
+}
+
+#endif
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_DEMUX_HPP
+#define AVS_DEMUX_HPP
+
+#include <boost/cstdint.hpp>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "dictionary.hpp"
+#include "log_entry.hpp"
+#include "logdump.hpp"
+#include "string_streambuf.hpp"
+
+// maximum number of output files kept open at once
+#define AVS_DEMUX_MAX_OPEN	64
+// amount of text buffered for each output before it gets written
+#define AVS_DEMUX_BUFFER_SIZE	(16 * 1024)
+
+// Stream of entries which were not recognized.
+#define AVS_DEMUX_UNKNOWN	(1ULL << 32)
+
+/*
+ * Writes text to one file per stream, named <prefix>.<stream>. Text is
+ * buffered per stream and only a limited number of files is kept open,
+ * least recently written ones get closed and are reopened for appending
+ * once needed again, so the number of streams is not bound by descriptor
+ * limits.
+ */
+class demux_writer {
+public:
+	demux_writer(const demux_writer &w) = delete;
+	demux_writer &operator=(demux_writer &w) = delete;
+
+	demux_writer(const std::string &prefix, enum demux_by by);
+
+	void write(uint64_t id, const char *text, size_t len);
+	// Writes out all buffered text and closes all files.
+	void close();
+
+	size_t streams() const
+	{
+		return outputs.size();
+	}
+
+private:
+	struct output {
+		std::string path;
+		std::string buf;
+		std::ofstream file;
+		bool created; // truncated already, append from now on
+		std::list<struct output *>::iterator lru;
+	};
+
+	struct output *get(uint64_t id);
+	void flush(struct output &o);
+	void close_oldest();
+
+	const std::string prefix;
+	const enum demux_by by;
+	std::unordered_map<uint64_t, std::unique_ptr<struct output>> outputs;
+	// open files, least recently written first
+	std::list<struct output *> open_files;
+};
+
+/*
+ * Decodes the trace and hands text of each entry to the stream selected
+ * by @by dimension of the entry.
+ * Returns 0 on success or negative error code.
+ */
+template <class EntryT>
+int demux_logdump(itrace_reader &in, dictionary_slot<typename EntryT::literal_type> &slot,
+		  demux_writer &writer, enum demux_by by, loss_detector *loss = nullptr)
+{
+	string_streambuf sb;
+	std::ostream text_out(&sb);
+	std::string text;
+	EntryT entry;
+	size_t mark = 0;
+
+	auto hook = [&](const char *raw, size_t size, uint32_t lib_id) {
+		uint64_t id = AVS_DEMUX_UNKNOWN;
+
+		if (size) {
+			entry.assign_ptr((char *)raw);
+			id = entry.demux_id(by);
+		}
+		writer.write(id, text.data() + mark, text.size() - mark);
+		mark = text.size();
+	};
+
+	sb.attach(&text);
+
+	return scan_logdump<EntryT>(in, [&](char *buf, size_t len, uint64_t base,
+					    size_t &consumed) {
+		text.clear();
+		mark = 0;
+		return decode_block<EntryT>(buf, len, base, text_out, *slot.get(), consumed,
+					    hook, loss);
+	});
+}
+
+#endif
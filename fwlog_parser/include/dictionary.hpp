@@ -0,0 +1,398 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_DICTIONARY_HPP
+#define AVS_DICTIONARY_HPP
+
+#include <boost/cstdint.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "string_arena.hpp"
+
+class detailed_path {
+public:
+	detailed_path(const std::string &p, int id)
+		: path(p), lib_id(id)
+	{
+	}
+
+	detailed_path()
+		: detailed_path("", 0)
+	{
+	}
+
+	std::string path;
+	int lib_id;
+};
+
+#if defined(__GNUC__)
+#define AVS_PREFETCH(ptr) __builtin_prefetch(ptr)
+#elif defined(_MSC_VER)
+#include <xmmintrin.h>
+#define AVS_PREFETCH(ptr) _mm_prefetch((const char *)(ptr), _MM_HINT_T0)
+#else
+#define AVS_PREFETCH(ptr)
+#endif
+
+#define AVS_DICT_EMPTY_SLOT UINT32_MAX
+
+/*
+ * Literals of all libraries stored contiguously and indexed with an open
+ * addressing hash table keyed by (lib_id, key) pair. Slots are small and
+ * their location is known before the lookup happens, what allows for
+ * prefetching them ahead of time when resolving entries in batches.
+ */
+template <typename LiteralT>
+class dictionary {
+public:
+	dictionary()
+		: table(1), mask(0)
+	{
+	}
+
+	void assign(std::map<int, std::map<uint64_t, LiteralT>> &libs)
+	{
+		size_t count = 0, capacity = 1;
+
+		for (auto it = libs.begin(); it != libs.end(); it++)
+			count += it->second.size();
+		// keep load factor at or below 50%
+		while (capacity < count * 2)
+			capacity <<= 1;
+
+		literals.clear();
+		literals.reserve(count);
+		table.assign(capacity, slot());
+		mask = capacity - 1;
+
+		for (auto lit = libs.begin(); lit != libs.end(); lit++) {
+			for (auto it = lit->second.begin(); it != lit->second.end(); it++) {
+				insert(lit->first, it->first, literals.size());
+				literals.push_back(std::move(it->second));
+			}
+		}
+	}
+
+	const LiteralT *find(uint32_t lib_id, uint64_t key) const
+	{
+		size_t i = hash(lib_id, key) & mask;
+
+		while (table[i].index != AVS_DICT_EMPTY_SLOT) {
+			if (table[i].key == key && table[i].lib_id == lib_id)
+				return &literals[table[i].index];
+			i = (i + 1) & mask;
+		}
+
+		return nullptr;
+	}
+
+	void prefetch(uint32_t lib_id, uint64_t key) const
+	{
+		AVS_PREFETCH(&table[hash(lib_id, key) & mask]);
+	}
+
+	size_t size() const
+	{
+		return literals.size();
+	}
+
+	// Literals are indexed contiguously from 0 to size() - 1.
+	const LiteralT &literal(size_t index) const
+	{
+		return literals[index];
+	}
+
+	size_t index_of(const LiteralT *literal) const
+	{
+		return literal - literals.data();
+	}
+
+	// Calls @visit with lib_id, key and literal of each entry, in no
+	// particular order.
+	template <class VisitT>
+	void for_each(VisitT &&visit) const
+	{
+		for (auto it = table.begin(); it != table.end(); it++)
+			if (it->index != AVS_DICT_EMPTY_SLOT)
+				visit(it->lib_id, it->key, literals[it->index]);
+	}
+
+	string_arena &strings()
+	{
+		return arena;
+	}
+
+	const string_arena &strings() const
+	{
+		return arena;
+	}
+
+private:
+	struct slot {
+		slot()
+			: key(0), lib_id(0), index(AVS_DICT_EMPTY_SLOT)
+		{
+		}
+
+		uint64_t key;
+		uint32_t lib_id;
+		uint32_t index;
+	};
+
+	static size_t hash(uint32_t lib_id, uint64_t key)
+	{
+		// Fibonacci hashing, lib_id occupies bits unused by either format
+		return (size_t)(((key ^ ((uint64_t)lib_id << 48)) * 0x9e3779b97f4a7c15ULL) >> 32);
+	}
+
+	void insert(uint32_t lib_id, uint64_t key, size_t index)
+	{
+		size_t i = hash(lib_id, key) & mask;
+
+		while (table[i].index != AVS_DICT_EMPTY_SLOT)
+			i = (i + 1) & mask;
+
+		table[i].key = key;
+		table[i].lib_id = lib_id;
+		table[i].index = (uint32_t)index;
+	}
+
+	std::vector<LiteralT> literals;
+	std::vector<struct slot> table;
+	size_t mask;
+	string_arena arena;
+};
+
+/*
+ * Literals of a single library along with their strings, built apart
+ * from other libraries.
+ */
+template <typename LiteralT>
+struct library_literals {
+	std::map<uint64_t, LiteralT> literals;
+	string_arena strings;
+};
+
+/*
+ * Each library is built by a thread of its own, so loading takes as long
+ * as the largest one does. Results are then moved into the dictionary,
+ * with the strings of each library appended to its arena; strings shared
+ * by libraries are stored once per library.
+ */
+template <typename LiteralT>
+void build_dictionary(dictionary<LiteralT> &dict, const std::vector<detailed_path> &paths)
+{
+	std::vector<std::unique_ptr<struct library_literals<LiteralT>>> built;
+	std::vector<std::future<void>> workers;
+	std::map<int, std::map<uint64_t, LiteralT>> libs;
+
+	for (auto it = paths.begin(); it != paths.end(); it++) {
+		struct library_literals<LiteralT> *lib = new library_literals<LiteralT>();
+		const std::string &path = it->path;
+
+		built.emplace_back(lib);
+		workers.push_back(std::async(std::launch::async, [lib, &path]() {
+			build_provider(lib->literals, lib->strings, path);
+		}));
+	}
+
+	// rethrows failure of a worker, others are waited for when dropped
+	for (auto it = workers.begin(); it != workers.end(); it++)
+		it->get();
+
+	for (size_t i = 0; i < paths.size(); i++) {
+		struct library_literals<LiteralT> &lib = *built[i];
+		uint32_t base = dict.strings().append(lib.strings);
+
+		for (auto it = lib.literals.begin(); it != lib.literals.end(); it++)
+			relocate_strings(it->second, base);
+		libs[paths[i].lib_id] = std::move(lib.literals);
+		built[i].reset();
+	}
+
+	dict.assign(libs);
+	dict.strings().seal();
+}
+
+/*
+ * Holds the dictionary used by the decoder and allows for replacing it
+ * while decoding is in progress. Only the decoder thread calls get() and
+ * it does so between records, so the swap never happens underneath an
+ * ongoing lookup. The retired dictionary is handed back to the publisher
+ * for destruction so the decoder never pays for freeing it.
+ */
+template <typename LiteralT>
+class dictionary_slot {
+public:
+	dictionary_slot(const dictionary_slot &s) = delete;
+	dictionary_slot &operator=(dictionary_slot &s) = delete;
+
+	explicit dictionary_slot(dictionary<LiteralT> *dict)
+		: current(dict), pending(nullptr), retired(nullptr)
+	{
+	}
+
+	~dictionary_slot()
+	{
+		delete current;
+		delete pending.load();
+		delete retired.load();
+	}
+
+	dictionary<LiteralT> *get()
+	{
+		if (pending.load(std::memory_order_relaxed)) {
+			dictionary<LiteralT> *next;
+
+			next = pending.exchange(nullptr, std::memory_order_acquire);
+			if (next) {
+				// publisher collects retired before each publish
+				// so normally there is nothing to free here
+				delete retired.exchange(current, std::memory_order_release);
+				current = next;
+			}
+		}
+
+		return current;
+	}
+
+	void publish(dictionary<LiteralT> *dict)
+	{
+		delete retired.exchange(nullptr, std::memory_order_acquire);
+		// previous update may not have been picked up yet
+		delete pending.exchange(dict, std::memory_order_acq_rel);
+	}
+
+private:
+	dictionary<LiteralT> *current;
+	std::atomic<dictionary<LiteralT> *> pending;
+	std::atomic<dictionary<LiteralT> *> retired;
+};
+
+// how often symbol files are checked for modifications, in milliseconds
+#define AVS_RELOAD_POLL_INTERVAL 500
+
+/*
+ * Rebuilds the dictionary in the background whenever any of the symbol
+ * files changes. Reflashing tools rewrite the files in several steps, so
+ * the rebuild is deferred until size and modification time of all files
+ * remain the same for a full poll interval.
+ */
+template <typename LiteralT>
+class dictionary_reloader {
+public:
+	dictionary_reloader(const dictionary_reloader &r) = delete;
+	dictionary_reloader &operator=(dictionary_reloader &r) = delete;
+
+	dictionary_reloader(dictionary_slot<LiteralT> &s, const std::vector<detailed_path> &p)
+		: slot(s), paths(p), done(false)
+	{
+		stamps = read_stamps();
+		worker = std::thread(&dictionary_reloader::run, this);
+	}
+
+	~dictionary_reloader()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			done = true;
+		}
+		cv.notify_one();
+		worker.join();
+	}
+
+private:
+	struct stamp {
+		uintmax_t size;
+		std::time_t mtime;
+
+		bool operator==(const stamp &s) const
+		{
+			return size == s.size && mtime == s.mtime;
+		}
+	};
+
+	std::vector<stamp> read_stamps() const
+	{
+		std::vector<stamp> result;
+
+		for (auto it = paths.begin(); it != paths.end(); it++) {
+			boost::system::error_code ec;
+			struct stamp s;
+
+			// file may be missing for a moment while being replaced
+			s.size = boost::filesystem::file_size(it->path, ec);
+			if (ec)
+				s.size = 0;
+			s.mtime = boost::filesystem::last_write_time(it->path, ec);
+			if (ec)
+				s.mtime = 0;
+			result.push_back(s);
+		}
+
+		return result;
+	}
+
+	void reload()
+	{
+		dictionary<LiteralT> *dict = new dictionary<LiteralT>;
+
+		try {
+			build_dictionary(*dict, paths);
+		} catch (std::exception &e) {
+			std::cerr << "dictionary reload failed: " << e.what() << std::endl;
+			delete dict;
+			return;
+		}
+
+		slot.publish(dict);
+		std::cerr << "dictionary reloaded" << std::endl;
+	}
+
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		bool dirty = false;
+
+		while (!cv.wait_for(lock, std::chrono::milliseconds(AVS_RELOAD_POLL_INTERVAL),
+				    [this] { return done; })) {
+			std::vector<stamp> now = read_stamps();
+
+			if (now != stamps) {
+				stamps = now;
+				dirty = true;
+			} else if (dirty) {
+				dirty = false;
+				reload();
+			}
+		}
+	}
+
+	dictionary_slot<LiteralT> &slot;
+	const std::vector<detailed_path> paths;
+	std::vector<stamp> stamps;
+
+	bool done;
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::thread worker;
+};
+
+#endif
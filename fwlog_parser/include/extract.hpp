@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_EXTRACT_HPP
+#define AVS_EXTRACT_HPP
+
+#include <boost/cstdint.hpp>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "dictionary.hpp"
+#include "itrace_reader.hpp"
+#include "logdump.hpp"
+#include "trace_index.hpp"
+
+/*
+ * Matches entries against a selection and a set of levels. Library, site
+ * and level are all attributes of the literal, so they are resolved once
+ * per dictionary into a flag per literal; only core and timestamp are
+ * checked entry by entry.
+ */
+template <class EntryT>
+class record_filter {
+public:
+	typedef typename EntryT::literal_type LiteralT;
+
+	record_filter(const struct index_selection &s, const std::vector<std::string> &l)
+		: sel(s), levels(l), bound_to(nullptr)
+	{
+	}
+
+	// Resolves literal criteria for @dict, unless done already.
+	void bind(const dictionary<LiteralT> &dict)
+	{
+		std::string level;
+
+		if (bound_to == &dict)
+			return;
+
+		matching.assign(dict.size(), 1);
+		dict.for_each([&](uint32_t lib_id, uint64_t key, const LiteralT &literal) {
+			uint8_t &m = matching[dict.index_of(&literal)];
+
+			if (!sel.libs.empty())
+				m &= std::find(sel.libs.begin(), sel.libs.end(), lib_id) !=
+				     sel.libs.end();
+			if (!sel.sites.empty())
+				m &= std::find(sel.sites.begin(), sel.sites.end(),
+					       std::make_pair(lib_id, key)) != sel.sites.end();
+			if (!levels.empty()) {
+				level.clear();
+				write_level(level, dict.strings(), &literal);
+				m &= std::find(levels.begin(), levels.end(), level) != levels.end();
+			}
+		});
+		bound_to = &dict;
+	}
+
+	bool match(const dictionary<LiteralT> &dict, const LiteralT *literal,
+		   const EntryT &entry) const
+	{
+		uint64_t timestamp;
+
+		if (!matching[dict.index_of(literal)])
+			return false;
+		if (!sel.cores.empty() &&
+		    std::find(sel.cores.begin(), sel.cores.end(), entry.core_id()) ==
+		    sel.cores.end())
+			return false;
+
+		timestamp = entry.timestamp();
+		return timestamp >= sel.from && timestamp <= sel.to;
+	}
+
+private:
+	const struct index_selection sel;
+	const std::vector<std::string> levels;
+	std::vector<uint8_t> matching; // per literal
+	const dictionary<LiteralT> *bound_to;
+};
+
+struct extract_stats {
+	uint64_t entries; // known to the dictionary
+	uint64_t kept;
+	uint64_t kept_bytes;
+	uint64_t dropped_bytes; // of unknown data, up to the end of the trace
+};
+
+/*
+ * Copies entries matching @filter to @out unchanged, so the result is a
+ * trace on its own. Nothing is rendered; unknown data is dropped, which
+ * leaves corrupted regions behind.
+ * Returns 0 on success or negative error code.
+ */
+template <class EntryT>
+int extract_logdump(itrace_reader &in, std::ostream &out,
+		    dictionary_slot<typename EntryT::literal_type> &slot,
+		    record_filter<EntryT> &filter, struct extract_stats &stats)
+{
+	typedef typename EntryT::literal_type LiteralT;
+
+	uint64_t expected = in.tell(); // end of the last known entry
+	EntryT entry;
+	int ret;
+
+	stats = extract_stats();
+	ret = scan_logdump<EntryT>(in, [&](char *buf, size_t len, uint64_t base,
+					   size_t &consumed) {
+		const dictionary<LiteralT> &dict = *slot.get();
+
+		filter.bind(dict);
+		return walk_block<EntryT>(buf, len, dict, consumed,
+					  [&](char *ptr, const struct record_index &rec,
+					      const LiteralT *literal) {
+			size_t size;
+
+			// unknown data, invalid headers included, is what lies
+			// between known entries
+			if (!literal)
+				return 0;
+
+			size = EntryT::size((unsigned char)*ptr);
+			stats.dropped_bytes += base + rec.pos - expected;
+			expected = base + rec.pos + size;
+
+			stats.entries++;
+			entry.assign_ptr(ptr);
+			if (!filter.match(dict, literal, entry))
+				return 0;
+
+			out.write(ptr, size);
+			stats.kept++;
+			stats.kept_bytes += size;
+			return 0;
+		});
+	});
+
+	if (ret < 0)
+		return ret;
+
+	// data past the last known entry
+	stats.dropped_bytes += in.tell() - expected;
+	return 0;
+}
+
+#endif
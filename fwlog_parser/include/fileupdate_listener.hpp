@@ -9,12 +9,12 @@
 #ifndef AVS_FILEUPDATE_LISTENER_HPP
 #define AVS_FILEUPDATE_LISTENER_HPP
 
-#if defined(__linux__)
-#include "fileupdate_listener_linux.hpp"
-typedef fileupdate_listener_linux fileupdate_listener;
-#elif defined(_WIN32) || defined (__CYGWIN__)
-#include "fileupdate_listener_win.hpp"
-typedef fileupdate_listener_win fileupdate_listener;
-#endif
+#include <memory>
+#include <string>
+#include "ifileupdate_listener.hpp"
+
+// Subscribes for updates of the file with a listener able to see them.
+// Returns nullptr if none could subscribe.
+std::unique_ptr<ifileupdate_listener> open_fileupdate_listener(const std::string &fullpath);
 
-#endif
\ No newline at end of file
+#endif
@@ -14,6 +14,9 @@
 #include <string>
 #include "ifileupdate_listener.hpp"
 
+// Tells whether writes to the file are reported by inotify.
+bool inotify_visible(const std::string &fullpath);
+
 class fileupdate_listener_linux : public ifileupdate_listener {
 public:
 	fileupdate_listener_linux();
@@ -26,12 +29,14 @@ public:
 	}
 
 	virtual int wait_for_signal() override;
+	virtual void interrupt() override;
 
 private:
 	void __unsubscribe();
 
 	int fd;
 	int wd;
+	int efd;
 	fd_set readfds;
 	std::string filename;
 };
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#if defined(__linux__)
+
+#ifndef AVS_FILEUPDATE_LISTENER_POLL_HPP
+#define AVS_FILEUPDATE_LISTENER_POLL_HPP
+
+#include <boost/cstdint.hpp>
+#include <string>
+#include "ifileupdate_listener.hpp"
+
+// bounds of the polling interval, in milliseconds
+#define AVS_POLL_MIN_INTERVAL	1
+#define AVS_POLL_MAX_INTERVAL	200
+
+// Tells whether the file may hold data past @offset it was read up to.
+// Sets @sized if its size follows its content and so can be relied on.
+bool poll_file_changed(const std::string &path, uint64_t offset, bool &sized);
+
+/*
+ * Listener for files no change notifications are generated for: debugfs
+ * and other pseudo filesystems, network mounts and character devices.
+ * The file is polled on timer ticks instead. While its size keeps up
+ * with what has been read, a tick signals only once the size changed.
+ * Otherwise the size says nothing and each tick lets the reader retry.
+ * Interval is doubled with every tick bringing no data, up to
+ * AVS_POLL_MAX_INTERVAL, and drops back to AVS_POLL_MIN_INTERVAL once
+ * the reader moves on, so bursts are followed closely and idle files
+ * cost close to nothing.
+ */
+class fileupdate_listener_poll : public ifileupdate_listener {
+public:
+	fileupdate_listener_poll();
+	virtual ~fileupdate_listener_poll();
+
+	virtual bool subscribe(const std::string &fullpath) override;
+	virtual void unsubscribe() override;
+	virtual void drained(uint64_t offset) override;
+	virtual int wait_for_signal() override;
+	virtual void interrupt() override;
+
+private:
+	int arm();
+
+	int tfd;
+	int efd;
+	std::string path;
+	uint64_t interval; // current one, in milliseconds
+	uint64_t offset; // input was drained at
+	bool advanced; // since the previous wait
+	bool sized; // size of the file follows its content
+};
+
+#endif // AVS_FILEUPDATE_LISTENER_POLL_HPP
+
+#endif // __linux__
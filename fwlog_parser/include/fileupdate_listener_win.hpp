@@ -37,6 +37,7 @@ public:
 	}
 
 	virtual int wait_for_signal() override;
+	virtual void interrupt() override;
 
 private:
 	static void CALLBACK completion_callback(DWORD dwErrorCode,
@@ -46,6 +47,7 @@ private:
 
 	void *hFile;
 	void *hEvent;
+	LONG volatile interrupted;
 	std::wstring filename;
 	unsigned char *buffer;
 	OVERLAPPED overlapped;
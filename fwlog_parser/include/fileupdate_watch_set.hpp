@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#if defined(__linux__)
+#define AVS_HAVE_WATCH_SET
+#endif
+
+#if defined(AVS_HAVE_WATCH_SET)
+
+#ifndef AVS_FILEUPDATE_WATCH_SET_HPP
+#define AVS_FILEUPDATE_WATCH_SET_HPP
+
+#include <boost/cstdint.hpp>
+#include <string>
+#include <vector>
+
+/*
+ * Waits for updates of any of a number of files with a single inotify
+ * instance, one watch per directory. Files inotify cannot see are polled
+ * on a shared timer instead, as fileupdate_listener_poll does for a
+ * single file; interval drops back to the minimum once any of them
+ * brings data.
+ */
+class fileupdate_watch_set {
+public:
+	fileupdate_watch_set(const fileupdate_watch_set &w) = delete;
+	fileupdate_watch_set &operator=(fileupdate_watch_set &w) = delete;
+
+	fileupdate_watch_set();
+	~fileupdate_watch_set();
+
+	// Returns index of the file within the set or negative error code.
+	int add(const std::string &fullpath);
+	// Tells file @index was read up to @offset, with no more data found there.
+	void drained(size_t index, uint64_t offset);
+	// Waits till any of the files may have been updated, stores indices
+	// of those in @ready. Returns 0 or positive error code, EINTR if
+	// interrupted.
+	int wait(std::vector<size_t> &ready);
+	// Makes pending or next wait() return EINTR. May be called from any thread.
+	void interrupt();
+
+private:
+	struct watched_file {
+		std::string path;
+		std::string filename;
+		int wd; // negative if polled
+		uint64_t offset; // file was drained at
+		bool advanced; // since the previous wait
+		bool sized; // size of the file follows its content
+	};
+
+	int read_events(std::vector<bool> &found);
+	int arm_timer();
+
+	int fd;
+	int tfd;
+	int efd;
+	uint64_t interval; // of polling, in milliseconds
+	std::vector<struct watched_file> files;
+};
+
+#endif // AVS_FILEUPDATE_WATCH_SET_HPP
+
+#endif // AVS_HAVE_WATCH_SET
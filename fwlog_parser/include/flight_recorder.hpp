@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_FLIGHT_RECORDER_HPP
+#define AVS_FLIGHT_RECORDER_HPP
+
+#include <boost/cstdint.hpp>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "dictionary.hpp"
+#include "ifileupdate_listener.hpp"
+#include "itrace_reader.hpp"
+#include "logdump.hpp"
+
+// default number of entries decoded past the trigger
+#define AVS_FLIGHT_AFTER	100
+// initial capacity of the window when its span is a time
+#define AVS_FLIGHT_MIN_RECORDS	1024
+
+struct flight_spec {
+	uint64_t before; // entries kept, 0 if window spans @span
+	uint64_t span; // timestamp ticks covered by the window
+	uint64_t after; // entries decoded past the trigger
+	std::vector<std::string> levels; // as write_level() names them
+	std::vector<std::pair<uint32_t, uint64_t>> sites; // lib_id and key
+};
+
+/*
+ * Keeps the most recent entries raw, in a window of spec.before entries
+ * or spec.span timestamp ticks, rendering nothing. Once an entry of one
+ * of the trigger levels or sites is found, the window is decoded along
+ * with spec.after entries following the trigger; another trigger among
+ * those extends it. Till then, the only work done per entry is the copy
+ * of its raw data, unknown ones are dropped.
+ */
+template <class EntryT>
+class flight_recorder {
+public:
+	typedef typename EntryT::literal_type LiteralT;
+
+	explicit flight_recorder(const struct flight_spec &s)
+		: spec(s), slot_size(2 * EntryT::max_size()), head(0), count(0), after_left(0),
+		  recorded(0), triggered(0), rendered(0), bound_to(nullptr)
+	{
+		size_t capacity = spec.before ? (size_t)spec.before : AVS_FLIGHT_MIN_RECORDS;
+
+		window.resize(capacity);
+		raw.resize(capacity * slot_size);
+	}
+
+	// Marks trigger literals of @dict, unless done already.
+	void bind(const dictionary<LiteralT> &dict)
+	{
+		std::string level;
+
+		if (bound_to == &dict)
+			return;
+
+		triggers.assign(dict.size(), 0);
+		for (size_t i = 0; i < dict.size(); i++) {
+			level.clear();
+			write_level(level, dict.strings(), &dict.literal(i));
+			for (auto it = spec.levels.begin(); it != spec.levels.end(); it++)
+				if (*it == level)
+					triggers[i] = 1;
+		}
+		for (auto it = spec.sites.begin(); it != spec.sites.end(); it++) {
+			const LiteralT *literal = dict.find(it->first, it->second);
+
+			if (literal)
+				triggers[dict.index_of(literal)] = 1;
+		}
+		bound_to = &dict;
+	}
+
+	// Records or, around triggers, decodes the entry at @position.
+	int entry(std::ostream &out, const dictionary<LiteralT> &dict, char *ptr,
+		  const LiteralT *literal, uint64_t position)
+	{
+		size_t size = EntryT::size((unsigned char)*ptr);
+		int ret;
+
+		if (triggers[dict.index_of(literal)]) {
+			if (!after_left) {
+				entry_.assign_ptr(ptr);
+				expire(entry_.timestamp());
+				out << "Trigger at position: " << (unsigned long long)position
+				    << "\n";
+				ret = replay(out, dict);
+				if (ret < 0)
+					return ret;
+				triggered++;
+			}
+			// the trigger itself first
+			after_left = spec.after + 1;
+		}
+
+		if (after_left) {
+			rendered++;
+			entry_.assign_ptr(ptr);
+			ret = write_entry(out, dict.strings(), literal, entry_,
+					  (uint32_t *)(ptr + EntryT::hdr_size()));
+			// context is complete, get it out of the door
+			if (!--after_left)
+				out.flush();
+			return ret;
+		}
+
+		record(ptr, size);
+		return 0;
+	}
+
+	void report(std::ostream &out) const
+	{
+		out << "recorded " << recorded << " entries, triggered " << triggered
+		    << " times, decoded " << rendered << " entries" << std::endl;
+	}
+
+private:
+	void record(const char *ptr, size_t size)
+	{
+		size_t tail;
+
+		entry_.assign_ptr((char *)ptr);
+		if (spec.before) {
+			if (count == window.size())
+				drop();
+		} else {
+			expire(entry_.timestamp());
+			if (count == window.size())
+				grow();
+		}
+
+		tail = (head + count) % window.size();
+		window[tail] = entry_.timestamp();
+		memcpy(&raw[tail * slot_size], ptr, size);
+		// formatters may access payload beyond the entry
+		memset(&raw[tail * slot_size + size], 0, slot_size - size);
+		count++;
+		recorded++;
+	}
+
+	// Drops entries older than the span before @timestamp, if window spans time.
+	void expire(uint64_t timestamp)
+	{
+		if (spec.before)
+			return;
+		while (count && window[head] + spec.span < timestamp)
+			drop();
+	}
+
+	void drop()
+	{
+		head = (head + 1) % window.size();
+		count--;
+	}
+
+	void grow()
+	{
+		std::vector<uint64_t> w(2 * window.size());
+		std::vector<char> r(w.size() * slot_size);
+
+		for (size_t i = 0; i < count; i++) {
+			size_t pos = (head + i) % window.size();
+
+			w[i] = window[pos];
+			memcpy(&r[i * slot_size], &raw[pos * slot_size], slot_size);
+		}
+		window.swap(w);
+		raw.swap(r);
+		head = 0;
+	}
+
+	// Decodes and empties the window.
+	int replay(std::ostream &out, const dictionary<LiteralT> &dict)
+	{
+		for (; count; drop()) {
+			char *ptr = &raw[head * slot_size];
+			const LiteralT *literal;
+			int ret;
+
+			entry_.assign_ptr(ptr);
+			// dictionary may have been reloaded since
+			literal = dict.find(entry_.lib_id(), entry_.key());
+			if (!literal)
+				continue;
+
+			rendered++;
+			ret = write_entry(out, dict.strings(), literal, entry_,
+					  (uint32_t *)(ptr + EntryT::hdr_size()));
+			if (ret < 0)
+				return ret;
+		}
+
+		return 0;
+	}
+
+	const struct flight_spec spec;
+	const size_t slot_size; // raw data kept per entry
+	std::vector<uint64_t> window; // timestamps of entries kept
+	std::vector<char> raw; // and their data
+	size_t head; // oldest entry kept
+	size_t count;
+	uint64_t after_left; // entries to be decoded still
+	EntryT entry_;
+
+	uint64_t recorded;
+	uint64_t triggered;
+	uint64_t rendered;
+
+	std::vector<uint8_t> triggers; // per literal
+	const dictionary<LiteralT> *bound_to;
+};
+
+/*
+ * Passes the trace through the recorder. If @listener is provided, the
+ * trace is followed till waiting for it fails, interruption included,
+ * otherwise recording ends with the data available. Output is flushed
+ * whenever decoding of a window completes and once the data runs out.
+ * Returns 0 on success or negative error code.
+ */
+template <class EntryT>
+int flight_logdump(itrace_reader &in, std::ostream &out,
+		   dictionary_slot<typename EntryT::literal_type> &slot,
+		   flight_recorder<EntryT> &recorder, ifileupdate_listener *listener = nullptr)
+{
+	typedef typename EntryT::literal_type LiteralT;
+
+	uint64_t next = in.tell();
+	int ret;
+
+	while (true) {
+		ret = scan_logdump<EntryT>(in, [&](char *buf, size_t len, uint64_t base,
+						   size_t &consumed) {
+			const dictionary<LiteralT> &dict = *slot.get();
+			int ret;
+
+			recorder.bind(dict);
+			ret = walk_block<EntryT>(buf, len, dict, consumed,
+						 [&](char *ptr, const struct record_index &rec,
+						     const LiteralT *literal) {
+				if (!literal)
+					return 0;
+				return recorder.entry(out, dict, ptr, literal, base + rec.pos);
+			});
+
+			next = base + consumed;
+			return ret;
+		});
+		if (ret < 0)
+			return ret;
+
+		out.flush();
+		if (!listener)
+			return 0;
+
+		// incomplete entry at the end is read again once completed
+		listener->drained(in.tell());
+		in.seek(next);
+		ret = listener->wait_for_signal();
+		if (ret)
+			return -ret;
+	}
+}
+
+#endif
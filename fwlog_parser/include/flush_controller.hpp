@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_FLUSH_CONTROLLER_HPP
+#define AVS_FLUSH_CONTROLLER_HPP
+
+#include <boost/cstdint.hpp>
+#include <chrono>
+#include <iostream>
+
+// default bound of the time text waits for a flush, in microseconds
+#define AVS_FLUSH_LATENCY	5000
+// default bound of the amount of text pending a flush, in bytes
+#define AVS_FLUSH_BATCH		(1024 * 1024)
+
+struct flush_policy {
+	flush_policy()
+		: max_latency(AVS_FLUSH_LATENCY), max_batch(AVS_FLUSH_BATCH)
+	{
+	}
+
+	std::chrono::microseconds max_latency;
+	size_t max_batch;
+};
+
+/*
+ * Decides when text written to the output gets flushed. Once the stream
+ * goes idle, pending text is flushed right away. Under load, text is
+ * coalesced until either the oldest of it waited for max_latency or
+ * max_batch bytes accumulated, so bursts end up in few large writes while
+ * latency stays bounded.
+ */
+class flush_controller {
+public:
+	explicit flush_controller(const struct flush_policy &p)
+		: policy(p), pending(0), flushed(0), idle_flushes(0), latency_flushes(0),
+		  batch_flushes(0), forced_flushes(0)
+	{
+	}
+
+	// Accounts @len bytes of text just written to the output.
+	void written(size_t len)
+	{
+		if (!pending && len)
+			oldest = std::chrono::steady_clock::now();
+		pending += len;
+	}
+
+	// More text is on its way, flushes @out only if bounds are reached.
+	void busy(std::ostream &out)
+	{
+		if (!pending)
+			return;
+
+		if (pending >= policy.max_batch) {
+			batch_flushes++;
+			flush(out);
+		} else if (std::chrono::steady_clock::now() - oldest >= policy.max_latency) {
+			latency_flushes++;
+			flush(out);
+		}
+	}
+
+	// No more text for now, flushes @out if anything is pending.
+	void idle(std::ostream &out)
+	{
+		if (!pending)
+			return;
+
+		idle_flushes++;
+		flush(out);
+	}
+
+	// Flushes @out regardless of the policy, e.g.: before saving progress.
+	void force(std::ostream &out)
+	{
+		forced_flushes++;
+		flush(out);
+	}
+
+	void report(std::ostream &out) const;
+
+private:
+	void flush(std::ostream &out)
+	{
+		out.flush();
+		flushed += pending;
+		pending = 0;
+	}
+
+	const struct flush_policy policy;
+	std::chrono::steady_clock::time_point oldest; // pending text written at
+	size_t pending;
+
+	uint64_t flushed;
+	uint64_t idle_flushes;
+	uint64_t latency_flushes;
+	uint64_t batch_flushes;
+	uint64_t forced_flushes;
+};
+
+#endif
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_GREP_HPP
+#define AVS_GREP_HPP
+
+#include <iostream>
+#include <regex>
+#include <string>
+#include <vector>
+#include "dictionary.hpp"
+#include "logdump.hpp"
+#include "string_streambuf.hpp"
+#include "text_template.hpp"
+
+// Longest run of characters each match of ECMAScript @pattern contains,
+// empty if there is none that could be determined.
+std::string required_literal(const std::string &pattern);
+
+/*
+ * Searches decoded text for a regular expression. Literals of the
+ * dictionary are matched first: only those whose text may contain the
+ * part every match requires become candidates, and only records of
+ * candidates are rendered and matched in full.
+ */
+template <typename LiteralT>
+class grep_filter {
+public:
+	explicit grep_filter(const std::string &pattern)
+		: re(pattern), needle(required_literal(pattern)), built_for(nullptr)
+	{
+	}
+
+	// Rebuilds the candidates if @dict differs from the last one seen.
+	void prepare(const dictionary<LiteralT> &dict)
+	{
+		std::string tmpl;
+
+		if (built_for == &dict)
+			return;
+
+		candidates.assign(dict.size(), false);
+		for (size_t i = 0; i < dict.size(); i++) {
+			tmpl.clear();
+			write_template(tmpl, dict.strings(), &dict.literal(i));
+			candidates[i] = template_may_contain(tmpl, needle);
+		}
+		built_for = &dict;
+	}
+
+	bool candidate(const dictionary<LiteralT> &dict, const LiteralT *literal) const
+	{
+		return candidates[dict.index_of(literal)];
+	}
+
+	// Whether any line of @text matches, as grep tells for each line
+	// without its newline, so anchors apply to lines of the record.
+	bool matches(const std::string &text) const
+	{
+		size_t pos = 0;
+
+		// much cheaper than the regex itself, weeds out most candidates
+		if (text.find(needle) == std::string::npos)
+			return false;
+
+		do {
+			size_t eol = text.find('\n', pos);
+
+			if (eol == std::string::npos)
+				eol = text.size();
+			if (std::regex_search(text.begin() + pos, text.begin() + eol, re))
+				return true;
+			pos = eol + 1;
+		} while (pos < text.size());
+
+		return false;
+	}
+
+private:
+	std::regex re;
+	std::string needle;
+	std::vector<bool> candidates;
+	const dictionary<LiteralT> *built_for;
+};
+
+/*
+ * Writes entries of the block whose text matches the filter to @out.
+ * Unknown entries are skipped silently, otherwise behaves as
+ * decode_block().
+ */
+template <class EntryT>
+int grep_block(char *buf, size_t len, std::ostream &out,
+	       const dictionary<typename EntryT::literal_type> &dict,
+	       grep_filter<typename EntryT::literal_type> &filter, size_t &consumed)
+{
+	typedef typename EntryT::literal_type LiteralT;
+
+	string_streambuf sb;
+	std::ostream text_out(&sb);
+	std::string text;
+	EntryT entry;
+
+	filter.prepare(dict);
+	sb.attach(&text);
+
+	return walk_block<EntryT>(buf, len, dict, consumed,
+				  [&](char *ptr, const struct record_index &rec,
+				      const LiteralT *literal) {
+		int ret;
+
+		if (!literal || !filter.candidate(dict, literal))
+			return 0;
+
+		text.clear();
+		entry.assign_ptr(ptr);
+		ret = write_entry(text_out, dict.strings(), literal, entry,
+				  (uint32_t *)(ptr + EntryT::hdr_size()));
+		if (ret < 0)
+			return ret;
+		if (filter.matches(text))
+			out << text;
+		return 0;
+	});
+}
+
+template <class EntryT>
+int grep_logdump(itrace_reader &in, std::ostream &out,
+		 dictionary_slot<typename EntryT::literal_type> &slot,
+		 grep_filter<typename EntryT::literal_type> &filter)
+{
+	return scan_logdump<EntryT>(in, [&](char *buf, size_t len, uint64_t base,
+					    size_t &consumed) {
+		return grep_block<EntryT>(buf, len, out, *slot.get(), filter, consumed);
+	});
+}
+
+#endif
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_HISTOGRAM_HPP
+#define AVS_HISTOGRAM_HPP
+
+#include <boost/cstdint.hpp>
+#include <iostream>
+#include <vector>
+
+// each power of two range is split into that many buckets
+#define AVS_HISTOGRAM_SUB_BUCKETS 16
+
+/*
+ * Histogram of 64-bit values in log-linear buckets: each power of two
+ * range is split evenly, so any value, and so any percentile, is known
+ * with relative error below 1/AVS_HISTOGRAM_SUB_BUCKETS while memory used
+ * stays constant.
+ */
+class histogram {
+public:
+	histogram();
+
+	void add(uint64_t value);
+
+	// Returns upper bound of the value found at given percentile.
+	uint64_t percentile(double p) const;
+
+	uint64_t count() const
+	{
+		return total;
+	}
+
+	uint64_t min() const
+	{
+		return lowest;
+	}
+
+	uint64_t max() const
+	{
+		return highest;
+	}
+
+	double mean() const
+	{
+		return total ? sum / total : 0;
+	}
+
+	// Prints summary followed by counts of each non-empty power of two
+	// range.
+	void print(std::ostream &out) const;
+
+private:
+	static size_t bucket(uint64_t value);
+	// smallest value which does not fall into bucket @b anymore
+	static uint64_t upper_bound(size_t b);
+
+	std::vector<uint64_t> buckets;
+	uint64_t total;
+	uint64_t lowest;
+	uint64_t highest;
+	double sum;
+};
+
+#endif
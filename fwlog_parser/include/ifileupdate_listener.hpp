@@ -9,6 +9,7 @@
 #ifndef AVS_IFILEUPDATE_LISTENER_HPP
 #define AVS_IFILEUPDATE_LISTENER_HPP
 
+#include <boost/cstdint.hpp>
 #include <string>
 
 class ifileupdate_listener {
@@ -26,7 +27,16 @@ public:
 
 	virtual bool subscribe(const std::string &fullpath) = 0;
 	virtual void unsubscribe() = 0;
+	// Tells the file was read up to @offset, with no more data found there.
+	// Listeners relying on notifications have no use for it.
+	virtual void drained(uint64_t offset)
+	{
+	}
+
 	virtual int wait_for_signal() = 0;
+	// Makes pending or next wait_for_signal() return with an error.
+	// May be called from any thread.
+	virtual void interrupt() = 0;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_IRECORD_SINK_HPP
+#define AVS_IRECORD_SINK_HPP
+
+#include <boost/cstdint.hpp>
+#include <string>
+#include <vector>
+
+// Location of a single record within a text_chunk. Records which were not
+// recognized come with no raw data.
+struct record_ref {
+	size_t text;
+	size_t text_len;
+	size_t raw;
+	size_t raw_len;
+	uint32_t lib_id;
+};
+
+struct text_chunk {
+	std::string text;
+	// filled only if records are consumed individually
+	std::string raw;
+	std::vector<struct record_ref> records;
+	bool last;
+};
+
+// Consumes decoded chunks record by record.
+class irecord_sink {
+public:
+	irecord_sink(const irecord_sink &s) = delete;
+	irecord_sink &operator=(irecord_sink &s) = delete;
+
+	irecord_sink()
+	{
+	}
+
+	virtual ~irecord_sink()
+	{
+	}
+
+	// Must not block, called from the pipeline's writer thread.
+	virtual void publish(const struct text_chunk &chunk) = 0;
+};
+
+#endif
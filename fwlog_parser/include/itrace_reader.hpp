@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_ITRACE_READER_HPP
+#define AVS_ITRACE_READER_HPP
+
+#include <boost/cstdint.hpp>
+#include <string>
+
+// maximum amount of trace data returned by a reader at once, in bytes
+#define AVS_CHUNK_SIZE (256 * 1024)
+
+class itrace_reader {
+public:
+	itrace_reader(const itrace_reader &r) = delete;
+	itrace_reader &operator=(itrace_reader &r) = delete;
+
+	itrace_reader()
+	{
+	}
+
+	virtual ~itrace_reader()
+	{
+	}
+
+	// Returns 0 on success or negative error code.
+	virtual int open(const std::string &path) = 0;
+
+	// Provides next chunk of the trace, up to AVS_CHUNK_SIZE bytes, valid
+	// till the next call. Zero length means there is no more data at the
+	// moment; reading may be resumed once the file grows.
+	// Returns 0 on success or negative error code.
+	virtual int next(const char **data, size_t *len) = 0;
+
+	// Offset of the data to be provided by the next call to next().
+	virtual uint64_t tell() const = 0;
+	virtual void seek(uint64_t offset) = 0;
+};
+
+#endif
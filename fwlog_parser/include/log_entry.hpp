@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_LOG_ENTRY_HPP
+#define AVS_LOG_ENTRY_HPP
+
+#include <boost/cstdint.hpp>
+#include <cstddef>
+#include <string>
+
+// Dimensions decoded output can be split along.
+enum demux_by {
+	DEMUX_CORE,
+	DEMUX_LIB,
+	DEMUX_MODULE, // module type and instance
+};
+
+/*
+ * Common base for firmware log entry formats. Each format derives from it
+ * and describes its layout with:
+ *
+ * literal_type - dictionary element the entries are resolved against
+ * length_mask	- mask of the length field (in DWORDs) found in the first byte
+ * extra_dwords	- number of payload DWORDs present regardless of length field
+ * is_valid()	- whether header looks like a genuine entry
+ * lib_id()	- library (provider) the entry comes from
+ * key()	- key of the entry within its library's dictionary
+ * can_demux()	- whether entries carry given demux_by dimension
+ * demux_id()	- value of given demux_by dimension
+ * core_id()	- DSP core the entry was logged on
+ * context()	- instance of firmware code the entry was logged by
+ * parse_key()	- converts textual form of a key, as given by user
+ *
+ * All of it is resolved at compile time so the framing of each format is
+ * open for inlining.
+ */
+template <class Derived, typename RecordT>
+class log_entry {
+public:
+	typedef RecordT record_type;
+
+	log_entry()
+		: data(nullptr)
+	{
+	}
+
+	void assign_ptr(char *buf)
+	{
+		data = (RecordT *)buf;
+	}
+
+	static constexpr size_t hdr_size()
+	{
+		return sizeof(RecordT);
+	}
+
+	static constexpr size_t size(unsigned int dwords = 0)
+	{
+		return ((dwords & Derived::length_mask) + Derived::extra_dwords) *
+		       sizeof(uint32_t) + sizeof(RecordT);
+	}
+
+	static constexpr size_t max_size()
+	{
+		return size(Derived::length_mask);
+	}
+
+	uint64_t timestamp() const
+	{
+		return data->timestamp;
+	}
+
+	RecordT *data;
+};
+
+union entry_key {
+	uint64_t entry_id;
+	struct {
+		uint32_t file_id;
+		uint32_t line_num;
+	};
+};
+
+#endif
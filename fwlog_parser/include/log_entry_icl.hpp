@@ -13,7 +13,8 @@
 #include <map>
 #include <string>
 #include <vector>
-#include "ilog_entry.hpp"
+#include "log_entry.hpp"
+#include "string_arena.hpp"
 
 struct log_literal2_0 {
 #pragma pack(push, 4)
@@ -26,8 +27,9 @@ struct log_literal2_0 {
 		uint32_t text_len;
 	} hdr;
 #pragma pack(pop)
-	std::string text;
-	std::string filename;
+	// string_arena offsets
+	uint32_t text;
+	uint32_t filename;
 	union entry_key key;
 };
 
@@ -42,55 +44,86 @@ struct log_entry2_0 {
 
 #define LOG_ENTRY2_LENGTH_MASK	0x7 // corresponds to entry_length
 
-class log_entry_icl : public ilog_entry {
+class log_entry_icl : public log_entry<log_entry_icl, struct log_entry2_0> {
 public:
-	log_entry_icl()
-		: data(nullptr)
+	typedef struct log_literal2_0 literal_type;
+
+	static constexpr unsigned int length_mask = LOG_ENTRY2_LENGTH_MASK;
+	static constexpr unsigned int extra_dwords = 0;
+
+	bool is_valid() const
 	{
+		return data->entry_id;
 	}
 
-	virtual void assign_ptr(char *buf) override
+	uint32_t lib_id() const
 	{
-		data = (struct log_entry2_0 *)buf;
+		return data->provider_id;
 	}
 
-	virtual size_t hdr_size() const override
+	uint64_t key() const
 	{
-		return sizeof(*data);
+		return data->entry_id;
 	}
 
-	virtual size_t size(unsigned int dwords = 0) const override
+	// neither core nor module is recorded
+	static constexpr bool can_demux(enum demux_by by)
 	{
-		return (dwords & LOG_ENTRY2_LENGTH_MASK) * sizeof(uint32_t) + sizeof(*data);
+		return by == DEMUX_LIB;
 	}
 
-	virtual size_t max_size() const override
+	uint32_t demux_id(enum demux_by by) const
 	{
-		return size(LOG_ENTRY2_LENGTH_MASK);
+		return data->provider_id;
 	}
 
-	virtual bool is_valid() const override
+	// not recorded, all entries share a single timeline
+	uint32_t core_id() const
 	{
-		return data->entry_id;
+		return 0;
 	}
 
-	virtual uint32_t lib_id() const override
+	// entries of a provider cannot be told apart
+	uint64_t context() const
 	{
 		return data->provider_id;
 	}
 
-	virtual uint64_t key() const override
+	// <entry_id>
+	static bool parse_key(const std::string &str, uint64_t &key);
+
+	// entry_id is 25 bits long
+	static uint32_t pack_key(uint64_t key)
 	{
-		return data->entry_id;
+		return (uint32_t)key;
 	}
 
-	struct log_entry2_0 *data;
+	static uint64_t unpack_key(uint32_t packed)
+	{
+		return packed;
+	}
 };
 
 void build_provider(std::map<uint64_t, struct log_literal2_0> &provider,
-		    const std::string &inpath);
+		    string_arena &strings, const std::string &inpath);
+
+// Moves string offsets of @literal by @base, once its strings are appended elsewhere.
+void relocate_strings(struct log_literal2_0 &literal, uint32_t base);
 
-int write_entry(std::ostream &out, struct log_literal2_0 *literal,
+int write_entry(std::ostream &out, const string_arena &strings,
+		const struct log_literal2_0 *literal,
 		const log_entry_icl &entry, uint32_t *data);
 
+// Appends template of the text write_entry() produces for @literal.
+void write_template(std::string &tmpl, const string_arena &strings,
+		    const struct log_literal2_0 *literal);
+
+// Appends location and unformatted message of the log site.
+void write_site(std::string &site, const string_arena &strings,
+		const struct log_literal2_0 *literal);
+
+// Appends level of the log site, numeric as found in the ELF.
+void write_level(std::string &level, const string_arena &strings,
+		 const struct log_literal2_0 *literal);
+
 #endif
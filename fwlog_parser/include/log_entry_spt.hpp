@@ -13,18 +13,20 @@
 #include <map>
 #include <string>
 #include <vector>
-#include "ilog_entry.hpp"
+#include "log_entry.hpp"
+#include "string_arena.hpp"
 
+// strings are stored as string_arena offsets
 struct log_literal1_5 {
 	union entry_key key;
-	std::string filename;
-	std::string provider;
-	std::string loglevel;
-	std::string message;
-	std::string param1;
-	std::string param2;
-	std::string param3;
-	std::string param4;
+	uint32_t filename;
+	uint32_t provider;
+	uint32_t loglevel;
+	uint32_t message;
+	uint32_t param1;
+	uint32_t param2;
+	uint32_t param3;
+	uint32_t param4;
 };
 
 #pragma pack(push, 4)
@@ -49,60 +51,102 @@ struct log_entry1_5 {
 
 #define LOG_ENTRY_LENGTH_MASK	0x3 // corresponds to entry_length
 
-class log_entry_spt : public ilog_entry {
+class log_entry_spt : public log_entry<log_entry_spt, struct log_entry1_5> {
 public:
-	log_entry_spt()
-		: data(nullptr)
+	typedef struct log_literal1_5 literal_type;
+
+	static constexpr unsigned int length_mask = LOG_ENTRY_LENGTH_MASK;
+	// there is always at least one DWORD after the header
+	static constexpr unsigned int extra_dwords = 1;
+
+	bool is_valid() const
 	{
+		return data->file_id && data->line_num;
 	}
 
-	void assign_ptr(char *buf) override
+	uint32_t lib_id() const
 	{
-		data = (struct log_entry1_5 *)buf;
+		return data->module.lib;
 	}
 
-	virtual size_t hdr_size() const override
+	uint64_t key() const
 	{
-		return sizeof(*data);
+		union entry_key key;
+
+		key.file_id = data->file_id;
+		key.line_num = data->line_num;
+		return key.entry_id;
 	}
 
-	virtual size_t size(unsigned int dwords = 0) const override
+	static constexpr bool can_demux(enum demux_by by)
 	{
-		// there is always at least one DWORD after the header
-		return ((dwords & LOG_ENTRY_LENGTH_MASK) + 1) * sizeof(uint32_t) + sizeof(*data);
+		return true;
 	}
 
-	virtual size_t max_size() const override
+	uint32_t demux_id(enum demux_by by) const
 	{
-		return size(LOG_ENTRY_LENGTH_MASK);
+		switch (by) {
+		case DEMUX_CORE:
+			return data->core_id;
+		case DEMUX_LIB:
+			return data->module.lib;
+		default:
+			return (uint32_t)data->module.type << 16 | data->instance_id;
+		}
 	}
 
-	virtual bool is_valid() const override
+	uint32_t core_id() const
 	{
-		return data->file_id && data->line_num;
+		return data->core_id;
 	}
 
-	virtual uint32_t lib_id() const override
+	uint64_t context() const
 	{
-		return data->module.lib;
+		return (uint64_t)data->core_id << 32 | demux_id(DEMUX_MODULE);
 	}
 
-	virtual uint64_t key() const override
+	// <file_id>:<line_num>
+	static bool parse_key(const std::string &str, uint64_t &key);
+
+	// file_id and line_num fit 16 bits each
+	static uint32_t pack_key(uint64_t key)
 	{
-		union entry_key key;
+		union entry_key k;
 
-		key.file_id = data->file_id;
-		key.line_num = data->line_num;
-		return key.entry_id;
+		k.entry_id = key;
+		return (k.file_id & 0xffff) | k.line_num << 16;
 	}
 
-	struct log_entry1_5 *data;
+	static uint64_t unpack_key(uint32_t packed)
+	{
+		union entry_key k;
+
+		k.file_id = packed & 0xffff;
+		k.line_num = packed >> 16;
+		return k.entry_id;
+	}
 };
 
 void build_provider(std::map<uint64_t, struct log_literal1_5> &provider,
-		    const std::string &inpath);
+		    string_arena &strings, const std::string &inpath);
+
+// Moves string offsets of @literal by @base, once its strings are appended elsewhere.
+void relocate_strings(struct log_literal1_5 &literal, uint32_t base);
 
-int write_entry(std::ostream &out, struct log_literal1_5 *literal,
+int write_entry(std::ostream &out, const string_arena &strings,
+		const struct log_literal1_5 *literal,
 		const log_entry_spt &entry, uint32_t *data);
 
+// Appends template of the text write_entry() produces for @literal.
+void write_template(std::string &tmpl, const string_arena &strings,
+		    const struct log_literal1_5 *literal);
+
+// Appends location and unformatted message of the log site.
+void write_site(std::string &site, const string_arena &strings,
+		const struct log_literal1_5 *literal);
+
+// Appends level of the log site, as named in the symbol file.
+void write_level(std::string &level, const string_arena &strings,
+		 const struct log_literal1_5 *literal);
+
 #endif
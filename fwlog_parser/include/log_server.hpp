@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#if defined(__linux__)
+#define AVS_HAVE_LOG_SERVER
+#endif
+
+#if defined(AVS_HAVE_LOG_SERVER)
+
+#ifndef AVS_LOG_SERVER_HPP
+#define AVS_LOG_SERVER_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "irecord_sink.hpp"
+
+// maximum amount of data queued for a single subscriber, in bytes
+#define AVS_SERVER_BACKLOG (4 * 1024 * 1024)
+// maximum length of subscription request
+#define AVS_SERVER_REQUEST_MAX 1024
+
+/*
+ * Fans decoded records out to subscribers connected to a local stream
+ * socket. Once connected, subscriber sends a single line describing what
+ * it is interested in, whitespace-separated:
+ *
+ *   text | binary	decoded text (default) or records as found in the trace
+ *   lib=<id>		only records of given library
+ *   drop | detach	when lagging behind, drop records (default) or get
+ *			disconnected
+ *   match=<string>	only records whose text contains the string, takes
+ *			the rest of the line
+ *
+ * Records are queued for each subscriber and sent by the server's thread,
+ * so a slow subscriber never holds the decoder up.
+ */
+class log_server : public irecord_sink {
+public:
+	explicit log_server(const std::string &path);
+	virtual ~log_server();
+
+	virtual void publish(const struct text_chunk &chunk) override;
+
+private:
+	struct subscriber {
+		subscriber(int f)
+			: fd(f), ready(false), closing(false), overrun(false),
+			  binary(false), detach(false),
+			  lib_id(-1), sent(0), dropped(0), lost(0)
+		{
+		}
+
+		int fd;
+		bool ready; // request received
+		bool closing;
+		bool overrun; // detached for lagging behind
+
+		bool binary;
+		bool detach;
+		long lib_id; // -1 matches all
+		std::string match;
+		std::string request;
+
+		std::string pending;
+		size_t sent;
+		uint64_t dropped; // since last notice
+		uint64_t lost;
+	};
+
+	void run();
+	void wake();
+	void accept_subscriber();
+	void read_request(struct subscriber &s);
+	void flush(struct subscriber &s);
+	void queue(struct subscriber &s, const struct text_chunk &chunk,
+		   const struct record_ref &r);
+
+	std::string path;
+	int listen_fd;
+	int efd;
+
+	std::mutex mutex;
+	std::vector<std::unique_ptr<struct subscriber>> subs;
+	std::atomic<bool> done;
+	std::thread worker;
+};
+
+#endif // AVS_LOG_SERVER_HPP
+
+#endif // AVS_HAVE_LOG_SERVER
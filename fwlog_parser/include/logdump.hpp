@@ -0,0 +1,321 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_LOGDUMP_HPP
+#define AVS_LOGDUMP_HPP
+
+#include <boost/cstdint.hpp>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+#include "dictionary.hpp"
+#include "itrace_reader.hpp"
+#include "log_entry.hpp"
+#include "loss_detector.hpp"
+
+// maximum number of records indexed before their resolution kicks in
+#define AVS_INDEX_BATCH		1024
+// how many records ahead dictionary slots are prefetched
+#define AVS_PREFETCH_DISTANCE	8
+
+// positions within a block are stored on 32 bits
+static_assert(AVS_CHUNK_SIZE < UINT32_MAX / 2, "chunk too large to be indexed");
+
+struct record_index {
+	uint32_t pos; // within the block
+	uint32_t lib_id;
+	uint64_t key;
+};
+
+/*
+ * First pass: frames the block and records the position and key of each
+ * valid entry. Bogus data is skipped over DWORD by DWORD. Stops once the
+ * remaining data does not hold a complete entry or the batch is full.
+ * Returns the position the framing stopped at.
+ */
+template <class EntryT>
+size_t index_block(char *buf, size_t pos, size_t len, std::vector<struct record_index> &index)
+{
+	EntryT entry;
+	size_t count = 0;
+
+	index.resize(AVS_INDEX_BATCH);
+
+	while (count < AVS_INDEX_BATCH && pos + EntryT::hdr_size() <= len) {
+		size_t size = EntryT::size((unsigned char)buf[pos]);
+		struct record_index *rec = &index[count];
+
+		if (pos + size > len)
+			break;
+
+		entry.assign_ptr(buf + pos);
+		bool valid = entry.is_valid();
+
+		// store unconditionally, slot is reused if entry is invalid
+		rec->pos = (uint32_t)pos;
+		rec->lib_id = entry.lib_id();
+		rec->key = entry.key();
+		count += valid;
+		pos += valid ? size : sizeof(uint32_t);
+	}
+
+	index.resize(count);
+	return pos;
+}
+
+/*
+ * Second pass: resolves indexed entries against the dictionary with slots
+ * prefetched a few entries ahead.
+ */
+template <typename LiteralT>
+void resolve_index(const dictionary<LiteralT> &dict, const std::vector<struct record_index> &index,
+		   std::vector<const LiteralT *> &literals)
+{
+	size_t count = index.size();
+
+	literals.resize(count);
+
+	for (size_t i = 0; i < count && i < AVS_PREFETCH_DISTANCE; i++)
+		dict.prefetch(index[i].lib_id, index[i].key);
+
+	for (size_t i = 0; i < count; i++) {
+		size_t ahead = i + AVS_PREFETCH_DISTANCE;
+
+		if (ahead < count)
+			dict.prefetch(index[ahead].lib_id, index[ahead].key);
+		literals[i] = dict.find(index[i].lib_id, index[i].key);
+	}
+}
+
+/*
+ * Skips bogus data DWORD by DWORD, framing and resolving a single entry
+ * at a time, till a known entry or an incomplete one is found at @pos.
+ * Restarting a batch at each DWORD instead would frame and resolve up to
+ * AVS_INDEX_BATCH entries per DWORD skipped. Unknown entries are passed
+ * to @visit as walk_block() does.
+ * Returns 0 on success or the error returned by @visit.
+ */
+template <class EntryT, class VisitT>
+int resync_block(char *buf, size_t &pos, size_t len,
+		 const dictionary<typename EntryT::literal_type> &dict, VisitT &visit)
+{
+	struct record_index rec;
+	EntryT entry;
+	int ret;
+
+	while (pos + EntryT::hdr_size() <= len) {
+		size_t size = EntryT::size((unsigned char)buf[pos]);
+
+		if (pos + size > len)
+			break;
+
+		entry.assign_ptr(buf + pos);
+		if (entry.is_valid()) {
+			rec.pos = (uint32_t)pos;
+			rec.lib_id = entry.lib_id();
+			rec.key = entry.key();
+			if (dict.find(rec.lib_id, rec.key))
+				break;
+
+			ret = visit(buf + pos, rec, nullptr);
+			if (ret < 0)
+				return ret;
+		}
+		pos += sizeof(uint32_t);
+	}
+
+	return 0;
+}
+
+/*
+ * Frames and resolves all complete entries found in the block and calls
+ * @visit for each of them with its literal, nullptr if the entry is
+ * unknown. On an unknown entry, data is skipped one DWORD at a time till
+ * a known entry is found, and framing in batches is restarted from there.
+ * Negative value returned by @visit stops the walk before the entry it
+ * was called for.
+ * Number of bytes consumed is stored in @consumed.
+ * Returns 0 on success or the error returned by @visit.
+ */
+template <class EntryT, class VisitT>
+int walk_block(char *buf, size_t len, const dictionary<typename EntryT::literal_type> &dict,
+	       size_t &consumed, VisitT &&visit)
+{
+	typedef typename EntryT::literal_type LiteralT;
+
+	std::vector<struct record_index> index;
+	std::vector<const LiteralT *> literals;
+	size_t pos = 0;
+	int ret = 0;
+
+	while (pos + EntryT::hdr_size() <= len) {
+		size_t end = index_block<EntryT>(buf, pos, len, index);
+		bool unknown = false;
+
+		resolve_index(dict, index, literals);
+
+		for (size_t i = 0; i < index.size(); i++) {
+			ret = visit(buf + index[i].pos, index[i], literals[i]);
+			if (ret < 0) {
+				end = index[i].pos;
+				break;
+			}
+			if (!literals[i]) {
+				// skip over bogus data (DWORD-aligned)
+				end = index[i].pos + sizeof(uint32_t);
+				unknown = true;
+				break;
+			}
+		}
+
+		if (ret < 0)
+			break;
+		if (unknown) {
+			pos = end;
+			ret = resync_block<EntryT>(buf, pos, len, dict, visit);
+			if (ret < 0)
+				break;
+			continue;
+		}
+		if (end == pos)
+			break; // no complete entry left
+		pos = end;
+	}
+
+	consumed = pos;
+	return ret;
+}
+
+// Default for decode_block(), ignores decoded records.
+struct no_record_hook {
+	void operator()(const char *raw, size_t size, uint32_t lib_id) const
+	{
+	}
+};
+
+/*
+ * Decodes all complete entries found in the block. Block must be padded
+ * with EntryT::max_size() bytes as formatters may access payload DWORDs
+ * beyond the actual length of an entry. @base is the file offset of the
+ * block, used in diagnostics only.
+ * Once text of a record has been written to @out, @hook is called with its
+ * raw data. Size of 0 denotes the record was not recognized.
+ * If @loss is provided, entries are checked for lost data and unknown ones
+ * are reported as a whole by the detector rather than DWORD by DWORD.
+ * Number of bytes consumed is stored in @consumed.
+ */
+template <class EntryT, class HookT>
+int decode_block(char *buf, size_t len, uint64_t base, std::ostream &out,
+		 const dictionary<typename EntryT::literal_type> &dict, size_t &consumed,
+		 HookT &hook, loss_detector *loss)
+{
+	typedef typename EntryT::literal_type LiteralT;
+
+	EntryT entry;
+
+	return walk_block<EntryT>(buf, len, dict, consumed,
+				  [&](char *ptr, const struct record_index &rec,
+				      const LiteralT *literal) {
+		int ret;
+
+		if (!literal) {
+			if (!loss) {
+				out << "Unknown record at position: "
+				    << (unsigned long long)(base + rec.pos) << "\n";
+				hook(ptr, 0, rec.lib_id);
+			}
+			return 0;
+		}
+
+		entry.assign_ptr(ptr);
+		if (loss)
+			loss->entry(out, base + rec.pos, EntryT::size((unsigned char)*ptr),
+				    entry.core_id(), entry.timestamp());
+		ret = write_entry(out, dict.strings(), literal, entry,
+				  (uint32_t *)(ptr + EntryT::hdr_size()));
+		if (ret < 0)
+			return ret;
+		hook(ptr, EntryT::size((unsigned char)*ptr), rec.lib_id);
+		return 0;
+	});
+}
+
+template <class EntryT>
+int decode_block(char *buf, size_t len, uint64_t base, std::ostream &out,
+		 const dictionary<typename EntryT::literal_type> &dict, size_t &consumed,
+		 loss_detector *loss = nullptr)
+{
+	struct no_record_hook hook;
+
+	return decode_block<EntryT>(buf, len, base, out, dict, consumed, hook, loss);
+}
+
+/*
+ * Feeds the trace, till the end of the data available, to @process in
+ * blocks padded for EntryT formatters. Data left unconsumed by @process,
+ * an incomplete entry at the end of the block, is passed again together
+ * with what follows it.
+ * Returns 0 on success or negative error code.
+ */
+template <class EntryT, class ProcessT>
+int scan_logdump(itrace_reader &in, ProcessT &&process)
+{
+	std::vector<char> block(AVS_CHUNK_SIZE + 2 * EntryT::max_size());
+	uint64_t base = in.tell();
+	size_t len = 0;
+
+	while (true) {
+		const char *data;
+		size_t size, consumed;
+		int ret;
+
+		ret = in.next(&data, &size);
+		if (ret < 0)
+			return ret;
+		if (!size)
+			break;
+
+		memcpy(block.data() + len, data, size);
+		len += size;
+
+		ret = process(block.data(), len, base, consumed);
+		if (ret < 0)
+			return ret;
+
+		len -= consumed;
+		base += consumed;
+		memmove(block.data(), block.data() + consumed, len);
+	}
+
+	return 0;
+}
+
+/*
+ * Decodes the trace till the end of the data available. Incomplete entry
+ * found at the very end is left unconsumed.
+ * Returns 0 on success or negative error code.
+ */
+template <class EntryT>
+int process_logdump(itrace_reader &in, std::ostream &out,
+		    dictionary_slot<typename EntryT::literal_type> &slot,
+		    loss_detector *loss = nullptr)
+{
+	typedef log_entry<EntryT, typename EntryT::record_type> BaseT;
+
+	static_assert(std::is_base_of<BaseT, EntryT>::value,
+		      "EntryT must be a derivate of log_entry");
+
+	return scan_logdump<EntryT>(in, [&](char *buf, size_t len, uint64_t base,
+					    size_t &consumed) {
+		// pick up reloaded dictionary, if any, between chunks
+		return decode_block<EntryT>(buf, len, base, out, *slot.get(), consumed, loss);
+	});
+}
+
+#endif
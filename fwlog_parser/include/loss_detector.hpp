@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_LOSS_DETECTOR_HPP
+#define AVS_LOSS_DETECTOR_HPP
+
+#include <boost/cstdint.hpp>
+#include <iostream>
+#include <vector>
+
+/*
+ * Watches framing and timestamps of recognized entries for signs of lost
+ * data: bytes skipped between entries, timestamps going back on a core
+ * and, if a threshold is given, gaps between timestamps of consecutive
+ * entries of a core. Each finding is noted inline, right before the entry
+ * it was found at, and accounted for in the summary.
+ */
+class loss_detector {
+public:
+	// @start: position of the first byte to be decoded
+	// @max_gap: largest timestamp increase not reported, 0 disables
+	loss_detector(uint64_t start, uint64_t max_gap);
+
+	void entry(std::ostream &out, uint64_t pos, size_t size, uint32_t core,
+		   uint64_t timestamp)
+	{
+		if (pos != expected)
+			skipped(out, pos);
+		expected = pos + size;
+
+		if (core >= cores.size())
+			cores.resize(core + 1);
+
+		struct core_state &c = cores[core];
+
+		if (c.seen) {
+			if (timestamp < c.last)
+				regressed(out, pos, core, c.last - timestamp);
+			else if (max_gap && timestamp - c.last > max_gap)
+				gap(out, pos, core, timestamp - c.last);
+		}
+		c.seen = true;
+		c.last = timestamp;
+	}
+
+	// @end: position right past the data available. Data left past the
+	// last entry is never followed by another one to reveal it, so it is
+	// accounted for here, as a burst of its own.
+	void report(std::ostream &out, uint64_t end) const;
+
+private:
+	struct core_state {
+		core_state()
+			: seen(false), last(0)
+		{
+		}
+
+		bool seen;
+		uint64_t last;
+	};
+
+	void skipped(std::ostream &out, uint64_t pos);
+	void regressed(std::ostream &out, uint64_t pos, uint32_t core, uint64_t delta);
+	void gap(std::ostream &out, uint64_t pos, uint32_t core, uint64_t delta);
+
+	const uint64_t max_gap;
+	uint64_t expected; // where the next entry should begin
+	std::vector<struct core_state> cores;
+
+	uint64_t skipped_bytes;
+	uint64_t bursts;
+	uint64_t regressions;
+	uint64_t gaps;
+	uint64_t largest_gap;
+};
+
+#endif
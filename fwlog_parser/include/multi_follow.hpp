@@ -0,0 +1,342 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_MULTI_FOLLOW_HPP
+#define AVS_MULTI_FOLLOW_HPP
+
+#include "fileupdate_watch_set.hpp"
+
+#if defined(AVS_HAVE_WATCH_SET)
+
+#include <boost/cstdint.hpp>
+#include <boost/filesystem/path.hpp>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "dictionary.hpp"
+#include "flush_controller.hpp"
+#include "logdump.hpp"
+#include "string_streambuf.hpp"
+#include "trace_reader_stream.hpp"
+
+// most chunks read from a single input before others get their turn
+#define AVS_MULTI_FOLLOW_BURST	4
+
+/*
+ * Follows a number of traces from a single thread. Inputs share the
+ * dictionary and a single fileupdate_watch_set, each one keeps only
+ * its reader and the entry left incomplete at the end of its data.
+ * Inputs with data pending are served in turns, AVS_MULTI_FOLLOW_BURST
+ * chunks at a time, so a flooding one does not starve the others.
+ * Text of each input goes either to <@outpath>.<input file name> or, if
+ * @merged is provided, into it with each line prefixed with the input
+ * path. Merged text is ordered by timestamp: an entry is written once
+ * every other input either has a later one decoded already or has been
+ * read till its end. Output is flushed as @fp dictates.
+ */
+template <class EntryT>
+class multi_follower {
+public:
+	typedef typename EntryT::literal_type LiteralT;
+
+	multi_follower(const multi_follower &f) = delete;
+	multi_follower &operator=(multi_follower &f) = delete;
+
+	multi_follower(const std::vector<std::string> &paths, std::ostream *merged,
+		       const std::string &outpath, dictionary_slot<LiteralT> &s,
+		       const struct flush_policy &fp = flush_policy())
+		: slot(s), out(merged), flusher(fp), finishing(false)
+	{
+		std::set<std::string> names;
+
+		for (auto it = paths.begin(); it != paths.end(); it++) {
+			std::unique_ptr<struct followed_input> in(new followed_input(fp));
+			std::string name = boost::filesystem::path(*it).filename().string();
+			int ret;
+
+			in->path = *it;
+			in->block.resize(AVS_CHUNK_SIZE + 2 * EntryT::max_size());
+			in->reader.reset(new trace_reader_stream());
+			if (in->reader->open(*it))
+				throw std::runtime_error("Failed to open " + *it);
+
+			if (!out) {
+				if (!names.insert(name).second)
+					throw std::runtime_error("Inputs named " + name +
+								 " would share the output, "
+								 "merge them instead.");
+				in->file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+				in->file.open(outpath + "." + name);
+			}
+
+			ret = watch.add(*it);
+			if (ret < 0)
+				throw std::runtime_error("Failed to watch " + *it + ": " +
+							 std::to_string(ret));
+			inputs.push_back(std::move(in));
+		}
+	}
+
+	// Follows all inputs till finish() is called or none of them can be read.
+	void run()
+	{
+		std::vector<size_t> ready;
+		int ret;
+
+		for (size_t i = 0; i < inputs.size(); i++)
+			ready.push_back(i);
+
+		while (!finishing) {
+			bool busy = false, alive = false;
+
+			for (auto it = ready.begin(); it != ready.end(); it++) {
+				if (inputs[*it]->failed)
+					continue;
+				drain(*inputs[*it]);
+				busy |= !inputs[*it]->dry;
+			}
+			if (out)
+				merge(false);
+
+			if (busy) {
+				for_each_output([](std::ostream &o, flush_controller &f) {
+					f.busy(o);
+				});
+				// updates are not waited for till all is read, try everything
+				ready.clear();
+				for (size_t i = 0; i < inputs.size(); i++)
+					ready.push_back(i);
+				continue;
+			}
+
+			// all caught up
+			for_each_output([](std::ostream &o, flush_controller &f) {
+				f.idle(o);
+			});
+			for (size_t i = 0; i < inputs.size(); i++) {
+				if (inputs[i]->failed)
+					continue;
+				watch.drained(i, inputs[i]->reader->tell());
+				alive = true;
+			}
+			if (!alive)
+				break;
+
+			ret = watch.wait(ready);
+			if (ret) {
+				if (ret != EINTR || !finishing)
+					std::cerr << "wait for updates failed: " << ret
+						  << std::endl;
+				break;
+			}
+		}
+
+		// text decoded so far still makes it to the output
+		if (out)
+			merge(true);
+		for_each_output([](std::ostream &o, flush_controller &f) {
+			f.idle(o);
+		});
+	}
+
+	// Stops following, run() returns shortly after. May be called from any thread.
+	void finish()
+	{
+		finishing = true;
+		watch.interrupt();
+	}
+
+private:
+	// text of an entry waiting for its turn in the merged output
+	struct pending_entry {
+		uint64_t timestamp;
+		size_t end; // within followed_input::text
+	};
+
+	struct followed_input {
+		explicit followed_input(const struct flush_policy &fp)
+			: len(0), dry(false), failed(false), flusher(fp), head(0), timestamp(0)
+		{
+		}
+
+		std::string path;
+		std::unique_ptr<itrace_reader> reader;
+		std::vector<char> block;
+		size_t len; // of data left undecoded in the block
+		bool dry; // read till the end of the data available
+		bool failed;
+
+		// own output
+		std::ofstream file;
+		flush_controller flusher;
+
+		// merged output
+		std::string text;
+		size_t head; // text written up to
+		std::deque<struct pending_entry> pending;
+		uint64_t timestamp; // of the last entry decoded
+	};
+
+	template <class FuncT>
+	void for_each_output(FuncT &&func)
+	{
+		if (out) {
+			func(*out, flusher);
+			return;
+		}
+		for (auto it = inputs.begin(); it != inputs.end(); it++)
+			func((*it)->file, (*it)->flusher);
+	}
+
+	void drain(struct followed_input &in)
+	{
+		for (int i = 0; i < AVS_MULTI_FOLLOW_BURST; i++) {
+			const char *data;
+			size_t len;
+			int ret;
+
+			ret = in.reader->next(&data, &len);
+			if (ret < 0) {
+				std::cerr << "read of " << in.path << " failed: " << ret
+					  << std::endl;
+				in.failed = true;
+			}
+			in.dry = ret < 0 || !len;
+			if (in.dry)
+				return;
+
+			memcpy(in.block.data() + in.len, data, len);
+			in.len += len;
+			decode(in);
+			if (in.failed)
+				return;
+		}
+	}
+
+	void decode(struct followed_input &in)
+	{
+		// pick up reloaded dictionary, if any, between chunks
+		const dictionary<LiteralT> &dict = *slot.get();
+		uint64_t base = in.reader->tell() - in.len;
+		std::ostream text_out(&sb);
+		size_t consumed;
+		EntryT entry;
+		int ret;
+
+		auto hook = [&](const char *raw, size_t size, uint32_t lib_id) {
+			struct pending_entry e;
+
+			// unknown ones go along with the last entry recognized
+			if (size) {
+				entry.assign_ptr((char *)raw);
+				in.timestamp = entry.timestamp();
+			}
+			e.timestamp = in.timestamp;
+			e.end = in.text.size();
+			in.pending.push_back(e);
+		};
+
+		if (out) {
+			sb.attach(&in.text);
+			ret = decode_block<EntryT>(in.block.data(), in.len, base, text_out, dict,
+						   consumed, hook, nullptr);
+		} else {
+			text.clear();
+			sb.attach(&text);
+			ret = decode_block<EntryT>(in.block.data(), in.len, base, text_out, dict,
+						   consumed);
+			in.file.write(text.data(), text.size());
+			in.flusher.written(text.size());
+		}
+		if (ret < 0) {
+			std::cerr << "decoding of " << in.path << " failed: " << ret << std::endl;
+			in.failed = true;
+			in.dry = true;
+		}
+
+		in.len -= consumed;
+		memmove(in.block.data(), in.block.data() + consumed, in.len);
+	}
+
+	// Writes out pending entries in timestamp order, all of them if @all.
+	void merge(bool all)
+	{
+		while (true) {
+			struct followed_input *next = nullptr;
+
+			for (auto it = inputs.begin(); it != inputs.end(); it++) {
+				struct followed_input *in = it->get();
+
+				if (in->pending.empty()) {
+					// more may be on its way, with earlier timestamps
+					if (!all && !in->dry)
+						return;
+					continue;
+				}
+				if (!next || in->pending.front().timestamp <
+					     next->pending.front().timestamp)
+					next = in;
+			}
+			if (!next)
+				return;
+
+			write_merged(*next);
+		}
+	}
+
+	void write_merged(struct followed_input &in)
+	{
+		size_t end = in.pending.front().end;
+		size_t pos = in.head;
+
+		in.pending.pop_front();
+		while (pos < end) {
+			const char *eol = (const char *)memchr(in.text.data() + pos, '\n',
+							       end - pos);
+			size_t next = eol ? eol - in.text.data() + 1 : end;
+
+			*out << in.path << ": ";
+			out->write(in.text.data() + pos, next - pos);
+			flusher.written(in.path.size() + 2 + next - pos);
+			pos = next;
+		}
+		in.head = end;
+
+		// drop text written, entries left refer to what follows it
+		if (in.pending.empty()) {
+			in.text.clear();
+			in.head = 0;
+		} else if (in.head >= AVS_CHUNK_SIZE && in.head > in.text.size() / 2) {
+			in.text.erase(0, in.head);
+			for (auto it = in.pending.begin(); it != in.pending.end(); it++)
+				it->end -= in.head;
+			in.head = 0;
+		}
+	}
+
+	std::vector<std::unique_ptr<struct followed_input>> inputs;
+	dictionary_slot<LiteralT> &slot;
+	fileupdate_watch_set watch;
+	std::ostream *out; // merged output
+	flush_controller flusher; // of the merged output
+	string_streambuf sb;
+	std::string text; // of the input being decoded, if not merging
+	std::atomic<bool> finishing;
+};
+
+#endif // AVS_HAVE_WATCH_SET
+
+#endif
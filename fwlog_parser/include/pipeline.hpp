@@ -0,0 +1,411 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_PIPELINE_HPP
+#define AVS_PIPELINE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "checkpoint.hpp"
+#include "dictionary.hpp"
+#include "fileupdate_listener.hpp"
+#include "flush_controller.hpp"
+#include "irecord_sink.hpp"
+#include "itrace_reader.hpp"
+#include "logdump.hpp"
+#include "spsc_ring.hpp"
+#include "string_streambuf.hpp"
+
+// number of chunks in flight between each pair of stages, power of two
+#define AVS_PIPELINE_DEPTH	16
+
+struct input_chunk {
+	std::unique_ptr<char[]> buf;
+	size_t len;
+	bool last;
+};
+
+// Text along with the state of the trace once it has been decoded.
+struct decoded_chunk : text_chunk {
+	uint64_t end; // trace offset of the data not consumed yet
+	uint64_t timestamp; // of the last entry decoded so far
+	uint64_t dictionary; // fingerprint, if checkpointing
+};
+
+// Accounts for the time a producer waited for its consumer to catch up.
+struct stall_stats {
+	stall_stats()
+		: count(0), time(0)
+	{
+	}
+
+	uint64_t count;
+	std::chrono::steady_clock::duration time;
+};
+
+/*
+ * Follows the trace with reading, decoding and writing done by separate
+ * threads, connected with lock-free rings. Each stage hands filled chunks
+ * over to the next one and gets them back once consumed, so a slow output
+ * device never holds the reader up for longer than it takes to drain all
+ * chunks in flight. Time spent waiting for a free chunk is accounted for
+ * and reported once following ends.
+ * Decoded text goes to @out and, record by record, to @sink. Either one
+ * may be omitted. Decoder checks entries with @loss, if provided. Once
+ * written, progress is saved with @ckpt every now and then, and when
+ * following ends. Output is flushed as @fp dictates.
+ */
+template <class EntryT>
+class follow_pipeline {
+public:
+	typedef typename EntryT::literal_type LiteralT;
+
+	follow_pipeline(const follow_pipeline &p) = delete;
+	follow_pipeline &operator=(follow_pipeline &p) = delete;
+
+	follow_pipeline(itrace_reader &i, const std::string &path, std::ostream *o,
+			dictionary_slot<LiteralT> &s, irecord_sink *rs = nullptr,
+			loss_detector *ld = nullptr, checkpointer *cp = nullptr,
+			const struct flush_policy &fp = flush_policy())
+		: in(i), inpath(path), out(o), slot(s), sink(rs), loss(ld), ckpt(cp), flusher(fp),
+		  raw(AVS_PIPELINE_DEPTH), raw_free(AVS_PIPELINE_DEPTH),
+		  text(AVS_PIPELINE_DEPTH), text_free(AVS_PIPELINE_DEPTH),
+		  raw_chunks(AVS_PIPELINE_DEPTH), text_chunks(AVS_PIPELINE_DEPTH),
+		  origin(i.tell()), resumed(cp ? cp->start() : checkpoint()),
+		  stop(false), finishing(false), listener(nullptr)
+	{
+		for (auto it = raw_chunks.begin(); it != raw_chunks.end(); it++) {
+			it->buf.reset(new char[AVS_CHUNK_SIZE]);
+			raw_free.push(&*it);
+		}
+		for (auto it = text_chunks.begin(); it != text_chunks.end(); it++)
+			text_free.push(&*it);
+	}
+
+	// Returns once reading fails or the output cannot be written to.
+	void run()
+	{
+		std::thread reader(&follow_pipeline::read_stage, this);
+		std::thread decoder(&follow_pipeline::decode_stage, this);
+
+		try {
+			write_stage();
+		} catch (...) {
+			abort();
+			reader.join();
+			decoder.join();
+			throw;
+		}
+
+		abort();
+		reader.join();
+		decoder.join();
+		report();
+	}
+
+	// Stops following, data read so far still makes it to the output and
+	// run() returns after that. May be called from any thread.
+	void finish()
+	{
+		std::lock_guard<std::mutex> lock(listener_mutex);
+
+		finishing = true;
+		if (listener)
+			listener->interrupt();
+	}
+
+private:
+	void abort()
+	{
+		std::lock_guard<std::mutex> lock(listener_mutex);
+
+		stop = true;
+		if (listener)
+			listener->interrupt();
+		raw.wake();
+		raw_free.wake();
+		text_free.wake();
+	}
+
+	// Takes a chunk from @ring, returns nullptr if pipeline is stopping.
+	template <typename T>
+	T *get(spsc_ring<T *> &ring, struct stall_stats *stats)
+	{
+		auto start = std::chrono::steady_clock::now();
+		T *chunk;
+
+		if (ring.pop(chunk))
+			return chunk;
+
+		// blocks while the trace is quiet
+		if (!ring.pop_wait(chunk, stop))
+			return nullptr;
+
+		if (stats) {
+			stats->count++;
+			stats->time += std::chrono::steady_clock::now() - start;
+		}
+		return chunk;
+	}
+
+	void read_stage()
+	{
+		std::unique_ptr<ifileupdate_listener> l = open_fileupdate_listener(inpath);
+		struct input_chunk *chunk = nullptr;
+		const char *data;
+		size_t len;
+		int ret;
+
+		if (l) {
+			std::lock_guard<std::mutex> lock(listener_mutex);
+
+			listener = l.get();
+			if (stop || finishing)
+				l->interrupt();
+		} else {
+			std::cerr << "failed to subscribe for " << inpath << " updates"
+				  << std::endl;
+		}
+
+		while (!stop && !finishing) {
+			if (!chunk) {
+				chunk = get(raw_free, &reader_stalls);
+				if (!chunk)
+					break;
+			}
+
+			ret = in.next(&data, &len);
+			if (ret < 0) {
+				std::cerr << "read failed: " << ret << std::endl;
+				break;
+			}
+
+			if (len) {
+				memcpy(chunk->buf.get(), data, len);
+				chunk->len = len;
+				chunk->last = false;
+				raw.push(chunk);
+				chunk = nullptr;
+				continue;
+			}
+
+			if (!l)
+				break; // nothing to wait on, what was there got read
+			l->drained(in.tell());
+			ret = l->wait_for_signal();
+			if (ret) {
+				if (!stop && !finishing)
+					std::cerr << "wait for signal failed: " << ret << std::endl;
+				break;
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(listener_mutex);
+
+			listener = nullptr;
+		}
+		if (l)
+			l->unsubscribe();
+
+		if (!chunk)
+			chunk = get(raw_free, nullptr);
+		if (chunk) {
+			chunk->len = 0;
+			chunk->last = true;
+			raw.push(chunk);
+		}
+	}
+
+	void decode_stage()
+	{
+		std::vector<char> block(AVS_CHUNK_SIZE + 2 * EntryT::max_size());
+		uint64_t base = origin;
+		string_streambuf sb;
+		std::ostream text_out(&sb);
+		size_t len = 0, mark;
+		struct decoded_chunk *t;
+		const dictionary<LiteralT> *fingerprinted = nullptr;
+		uint64_t timestamp = resumed.timestamp;
+		uint64_t fingerprint = 0;
+		EntryT entry;
+
+		auto hook = [&](const char *raw, size_t size, uint32_t lib_id) {
+			struct record_ref r;
+
+			if (size) {
+				entry.assign_ptr((char *)raw);
+				timestamp = entry.timestamp();
+			}
+			if (!sink)
+				return;
+			r.text = mark;
+			r.text_len = t->text.size() - mark;
+			r.raw = t->raw.size();
+			r.raw_len = size;
+			r.lib_id = lib_id;
+			t->raw.append(raw, size);
+			t->records.push_back(r);
+			mark = t->text.size();
+		};
+
+		while (true) {
+			struct input_chunk *chunk = get(raw, nullptr);
+			if (!chunk)
+				return;
+
+			memcpy(block.data() + len, chunk->buf.get(), chunk->len);
+			len += chunk->len;
+			bool last = chunk->last;
+			raw_free.push(chunk);
+
+			t = get(text_free, &decoder_stalls);
+			if (!t)
+				return;
+
+			size_t consumed;
+			t->text.clear();
+			t->raw.clear();
+			t->records.clear();
+			t->last = last;
+			sb.attach(&t->text);
+			mark = 0;
+
+			// pick up reloaded dictionary, if any, between chunks
+			const dictionary<LiteralT> &dict = *slot.get();
+
+			if (ckpt && fingerprinted != &dict) {
+				fingerprint = dictionary_fingerprint(dict);
+				fingerprinted = &dict;
+			}
+
+			if (decode_block<EntryT>(block.data(), len, base, text_out, dict,
+						 consumed, hook, loss) < 0)
+				t->last = true;
+
+			len -= consumed;
+			base += consumed;
+			t->end = base;
+			t->timestamp = timestamp;
+			t->dictionary = fingerprint;
+			memmove(block.data(), block.data() + consumed, len);
+
+			text.push(t);
+			if (t->last)
+				return;
+		}
+	}
+
+	void write_stage()
+	{
+		struct checkpoint cp = resumed;
+		// writer stops only once the last chunk is written
+		const std::atomic<bool> never(false);
+
+		while (true) {
+			struct decoded_chunk *t;
+
+			if (!text.pop(t)) {
+				// nothing more to write for now
+				if (out)
+					flusher.idle(*out);
+				// trace may stay quiet for long, save what is done
+				while (!text.pop_wait(t, never, ckpt ?
+						std::chrono::milliseconds(AVS_CHECKPOINT_INTERVAL) :
+						std::chrono::milliseconds(0)))
+					if (ckpt && ckpt->due())
+						save(cp);
+			}
+
+			if (out) {
+				out->write(t->text.data(), t->text.size());
+				flusher.written(t->text.size());
+				flusher.busy(*out);
+			}
+			if (sink)
+				sink->publish(*t);
+			bool last = t->last;
+
+			cp.offset = t->end;
+			cp.timestamp = t->timestamp;
+			cp.output += t->text.size();
+			cp.dictionary = t->dictionary;
+			text_free.push(t);
+
+			if (ckpt && (last || ckpt->due()))
+				save(cp);
+			if (last)
+				break;
+		}
+
+		if (out)
+			flusher.idle(*out);
+	}
+
+	// Text of all the data consumed must be out before its progress is.
+	void save(const struct checkpoint &cp)
+	{
+		int ret;
+
+		if (out)
+			flusher.force(*out);
+
+		ret = ckpt->save(cp);
+		if (ret < 0)
+			std::cerr << "checkpoint save failed: " << ret << std::endl;
+	}
+
+	void report() const
+	{
+		using std::chrono::duration_cast;
+		using std::chrono::milliseconds;
+
+		std::cerr << "reader waited for decoder " << reader_stalls.count << " times ("
+			  << duration_cast<milliseconds>(reader_stalls.time).count() << "ms), "
+			  << "decoder waited for writer " << decoder_stalls.count << " times ("
+			  << duration_cast<milliseconds>(decoder_stalls.time).count() << "ms)"
+			  << std::endl;
+		if (out)
+			flusher.report(std::cerr);
+	}
+
+	itrace_reader &in;
+	const std::string inpath;
+	std::ostream *out;
+	dictionary_slot<LiteralT> &slot;
+	irecord_sink *sink;
+	loss_detector *loss; // used by decoder only
+	checkpointer *ckpt; // used by writer only
+	flush_controller flusher; // used by writer only
+
+	spsc_ring<struct input_chunk *> raw;
+	spsc_ring<struct input_chunk *> raw_free;
+	spsc_ring<struct decoded_chunk *> text;
+	spsc_ring<struct decoded_chunk *> text_free;
+	std::vector<struct input_chunk> raw_chunks;
+	std::vector<struct decoded_chunk> text_chunks;
+	const uint64_t origin;
+	const struct checkpoint resumed;
+
+	std::atomic<bool> stop;
+	std::atomic<bool> finishing;
+	std::mutex listener_mutex;
+	ifileupdate_listener *listener;
+
+	struct stall_stats reader_stalls;
+	struct stall_stats decoder_stalls;
+};
+
+#endif
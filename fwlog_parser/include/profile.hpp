@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_PROFILE_HPP
+#define AVS_PROFILE_HPP
+
+#include <boost/cstdint.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "dictionary.hpp"
+#include "logdump.hpp"
+
+// default span of time peak rates are counted over, in timestamp ticks
+#define AVS_PROFILE_WINDOW	1000000
+
+/*
+ * Accounts entries and bytes to the log sites they were logged at. Sites
+ * are the dictionary literals, so counters are a flat array indexed the
+ * same way and accounting an entry takes no lookup beyond the one framing
+ * does anyway. Peak rate of a site is the highest number of its entries
+ * found within a single window of timestamps.
+ */
+template <typename LiteralT>
+class site_profiler {
+public:
+	explicit site_profiler(uint64_t w)
+		: window(w), unknown(0), bound_to(nullptr)
+	{
+	}
+
+	// Sizes counters for @dict, unless done already.
+	void bind(const dictionary<LiteralT> &dict)
+	{
+		if (bound_to == &dict)
+			return;
+
+		// counts of literals of another dictionary are meaningless
+		sites.assign(dict.size(), site_stats());
+		bound_to = &dict;
+	}
+
+	void record(const dictionary<LiteralT> &dict, const LiteralT *literal, size_t size,
+		    uint64_t timestamp)
+	{
+		struct site_stats &s = sites[dict.index_of(literal)];
+		uint64_t w = timestamp / window;
+
+		s.count++;
+		s.bytes += size;
+		if (w != s.window) {
+			s.window = w;
+			s.in_window = 0;
+		}
+		if (++s.in_window > s.peak)
+			s.peak = s.in_window;
+	}
+
+	// bogus data found between entries
+	void record_unknown(uint64_t bytes)
+	{
+		unknown += bytes;
+	}
+
+	// Lists @top sites logging the most bytes. @total is the amount of
+	// data the shares are counted from.
+	void report(std::ostream &out, size_t top, uint64_t total) const
+	{
+		std::vector<uint32_t> order;
+		uint64_t entries = 0;
+		char buf[128];
+
+		for (size_t i = 0; i < sites.size(); i++) {
+			entries += sites[i].count;
+			if (sites[i].count)
+				order.push_back((uint32_t)i);
+		}
+
+		top = std::min(top, order.size());
+		std::partial_sort(order.begin(), order.begin() + top, order.end(),
+				  [this](uint32_t a, uint32_t b) {
+			if (sites[a].bytes != sites[b].bytes)
+				return sites[a].bytes > sites[b].bytes;
+			return sites[a].count > sites[b].count;
+		});
+
+		snprintf(buf, sizeof(buf), "%llu entries of %zu sites in %llu bytes, "
+			 "%llu bytes unknown\n", (unsigned long long)entries, order.size(),
+			 (unsigned long long)total, (unsigned long long)unknown);
+		out << buf;
+		snprintf(buf, sizeof(buf), "%4s %12s %7s %10s  site\n", "rank", "count", "share",
+			 "peak");
+		out << buf;
+
+		for (size_t i = 0; i < top; i++) {
+			const struct site_stats &s = sites[order[i]];
+			std::string site;
+
+			write_site(site, bound_to->strings(), &bound_to->literal(order[i]));
+			snprintf(buf, sizeof(buf), "%4zu %12llu %6.2f%% %10llu  ", i + 1,
+				 (unsigned long long)s.count,
+				 total ? 100.0 * s.bytes / total : 0.0,
+				 (unsigned long long)s.peak);
+			out << buf << escape(site) << "\n";
+		}
+
+		out << "peak is the count within " << window << " timestamp ticks" << std::endl;
+	}
+
+private:
+	struct site_stats {
+		site_stats()
+			: count(0), bytes(0), window(UINT64_MAX), in_window(0), peak(0)
+		{
+		}
+
+		uint64_t count;
+		uint64_t bytes;
+		uint64_t window; // the last entry was found in
+		uint64_t in_window;
+		uint64_t peak;
+	};
+
+	// keeps one site per line
+	static std::string escape(const std::string &str)
+	{
+		std::string result;
+
+		for (auto it = str.begin(); it != str.end(); it++) {
+			if (*it == '\n')
+				result += "\\n";
+			else if (*it != '\r')
+				result += *it;
+		}
+
+		return result;
+	}
+
+	const uint64_t window;
+	std::vector<struct site_stats> sites;
+	uint64_t unknown; // in bytes
+	const dictionary<LiteralT> *bound_to;
+};
+
+/*
+ * Walks the trace accounting all entries to their sites. No text is
+ * rendered, so the walk runs at the speed of framing.
+ * Amount of data walked is stored in @total.
+ * Returns 0 on success or negative error code.
+ */
+template <class EntryT>
+int profile_logdump(itrace_reader &in, dictionary_slot<typename EntryT::literal_type> &slot,
+		    site_profiler<typename EntryT::literal_type> &profiler, uint64_t &total)
+{
+	typedef typename EntryT::literal_type LiteralT;
+
+	uint64_t start = in.tell();
+	uint64_t expected = start; // end of the last known entry
+	EntryT entry;
+	int ret;
+
+	total = 0;
+	ret = scan_logdump<EntryT>(in, [&](char *buf, size_t len, uint64_t base,
+					   size_t &consumed) {
+		const dictionary<LiteralT> &dict = *slot.get();
+		int ret;
+
+		profiler.bind(dict);
+
+		ret = walk_block<EntryT>(buf, len, dict, consumed,
+					 [&](char *ptr, const struct record_index &rec,
+					     const LiteralT *literal) {
+			size_t size;
+
+			// unknown data, invalid headers included, is what lies
+			// between known entries
+			if (!literal)
+				return 0;
+
+			size = EntryT::size((unsigned char)*ptr);
+			if (base + rec.pos > expected)
+				profiler.record_unknown(base + rec.pos - expected);
+			expected = base + rec.pos + size;
+
+			entry.assign_ptr(ptr);
+			profiler.record(dict, literal, size, entry.timestamp());
+			return 0;
+		});
+
+		total = base + consumed - start;
+		return ret;
+	});
+
+	if (start + total > expected)
+		profiler.record_unknown(start + total - expected);
+	return ret;
+}
+
+#endif
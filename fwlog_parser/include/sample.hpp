@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_SAMPLE_HPP
+#define AVS_SAMPLE_HPP
+
+#include <boost/cstdint.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "dictionary.hpp"
+#include "itrace_reader.hpp"
+#include "logdump.hpp"
+
+// fixed, so runs over the same trace pick the same entries
+#define AVS_SAMPLE_SEED		0x5eed
+// default amount of data decoded at each sampling point, in bytes
+#define AVS_SAMPLE_BURST	(64 * 1024)
+
+enum sample_mode {
+	SAMPLE_EVERY,
+	SAMPLE_FRACTION,
+	SAMPLE_BLOCKS,
+};
+
+struct sample_spec {
+	enum sample_mode mode;
+	uint64_t every; // SAMPLE_EVERY
+	double fraction; // SAMPLE_FRACTION, within (0, 1]
+	uint64_t blocks; // SAMPLE_BLOCKS, number of sampling points
+	size_t burst; // SAMPLE_BLOCKS, bytes decoded at each point
+};
+
+// Parses every:<n>, fraction:<f> or blocks:<count>[:<burst>], bursts
+// are AVS_CHUNK_SIZE at most. Throws std::invalid_argument if invalid.
+struct sample_spec parse_sample(const std::string &spec);
+
+/*
+ * Picks entries to be decoded: every Nth one or a random fraction of them.
+ * For the latter, gaps between picks are drawn from geometric distribution
+ * so the generator is consulted once per pick rather than once per entry.
+ */
+class entry_sampler {
+public:
+	explicit entry_sampler(const struct sample_spec &s)
+		: spec(s), rng(AVS_SAMPLE_SEED),
+		  gap(s.mode == SAMPLE_FRACTION ? s.fraction : 1.0)
+	{
+		skip = spec.mode == SAMPLE_EVERY ? 0 : next_gap();
+	}
+
+	bool pick()
+	{
+		if (skip) {
+			skip--;
+			return false;
+		}
+
+		skip = next_gap();
+		return true;
+	}
+
+private:
+	uint64_t next_gap()
+	{
+		return spec.mode == SAMPLE_EVERY ? spec.every - 1 : gap(rng);
+	}
+
+	const struct sample_spec spec;
+	std::mt19937_64 rng;
+	std::geometric_distribution<uint64_t> gap;
+	uint64_t skip; // entries left till the next pick
+};
+
+/*
+ * Walks the whole trace but renders only entries picked by the sampler,
+ * what makes up for most of the decoding time. Unknown entries are not
+ * reported.
+ * Returns 0 on success or negative error code.
+ */
+template <class EntryT>
+int sample_logdump(itrace_reader &in, std::ostream &out,
+		   dictionary_slot<typename EntryT::literal_type> &slot,
+		   const struct sample_spec &spec)
+{
+	typedef typename EntryT::literal_type LiteralT;
+
+	entry_sampler sampler(spec);
+	uint64_t total = 0, picked = 0;
+	EntryT entry;
+	int ret;
+
+	ret = scan_logdump<EntryT>(in, [&](char *buf, size_t len, uint64_t base,
+					   size_t &consumed) {
+		const dictionary<LiteralT> &dict = *slot.get();
+
+		return walk_block<EntryT>(buf, len, dict, consumed,
+					  [&](char *ptr, const struct record_index &rec,
+					      const LiteralT *literal) {
+			if (!literal)
+				return 0;
+
+			total++;
+			if (!sampler.pick())
+				return 0;
+
+			picked++;
+			entry.assign_ptr(ptr);
+			return write_entry(out, dict.strings(), literal, entry,
+					   (uint32_t *)(ptr + EntryT::hdr_size()));
+		});
+	});
+
+	std::cerr << "sampled " << picked << " of " << total << " entries" << std::endl;
+	return ret;
+}
+
+/*
+ * Decodes a burst of spec.burst bytes at each of spec.blocks points spread
+ * evenly over @size bytes of the trace, reading nothing in between. Each
+ * burst is preceded by its position; decoding begins at the first entry
+ * found there, so framing resyncs without noise.
+ * Returns 0 on success or negative error code.
+ */
+template <class EntryT>
+int sample_blocks(itrace_reader &in, uint64_t size, std::ostream &out,
+		  dictionary_slot<typename EntryT::literal_type> &slot,
+		  const struct sample_spec &spec)
+{
+	typedef typename EntryT::literal_type LiteralT;
+
+	std::vector<char> block;
+	uint64_t stride = size / spec.blocks;
+	uint64_t next = 0, decoded = 0, picked = 0;
+	EntryT entry;
+
+	// positions within a block are 32-bit
+	if (spec.burst > AVS_CHUNK_SIZE)
+		return -EINVAL;
+	block.resize(spec.burst + 2 * EntryT::max_size());
+
+	for (uint64_t i = 0; i < spec.blocks && next < size; i++) {
+		// entries are DWORD-aligned, bursts never overlap
+		uint64_t pos = std::max<uint64_t>(i * stride & ~3ULL, next);
+		const dictionary<LiteralT> &dict = *slot.get();
+		bool synced = pos == next && i;
+		size_t len = 0, consumed;
+		int ret;
+
+		in.seek(pos);
+		while (len < spec.burst) {
+			const char *data;
+			size_t n;
+
+			ret = in.next(&data, &n);
+			if (ret < 0)
+				return ret;
+			if (!n)
+				break;
+
+			n = std::min(n, spec.burst - len);
+			memcpy(block.data() + len, data, n);
+			len += n;
+		}
+		decoded += len;
+
+		if (!synced)
+			out << "Sample at position: " << (unsigned long long)pos << "\n";
+
+		ret = walk_block<EntryT>(block.data(), len, dict, consumed,
+					 [&](char *ptr, const struct record_index &rec,
+					     const LiteralT *literal) {
+			if (!literal) {
+				if (synced)
+					out << "Unknown record at position: "
+					    << (unsigned long long)(pos + rec.pos) << "\n";
+				return 0;
+			}
+
+			synced = true;
+			picked++;
+			entry.assign_ptr(ptr);
+			return write_entry(out, dict.strings(), literal, entry,
+					   (uint32_t *)(ptr + EntryT::hdr_size()));
+		});
+		if (ret < 0)
+			return ret;
+
+		next = pos + consumed;
+		if (len < spec.burst)
+			break; // end of the trace
+	}
+
+	std::cerr << "sampled " << picked << " entries, decoded " << decoded << " of " << size
+		  << " bytes" << std::endl;
+	return 0;
+}
+
+#endif
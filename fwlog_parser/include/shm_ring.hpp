@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#if defined(__linux__)
+#define AVS_HAVE_SHM_RING
+#endif
+
+#if defined(AVS_HAVE_SHM_RING)
+
+#ifndef AVS_SHM_RING_HPP
+#define AVS_SHM_RING_HPP
+
+#include <boost/cstdint.hpp>
+#include <atomic>
+#include <iostream>
+#include <string>
+#include "dictionary.hpp"
+#include "flush_controller.hpp"
+#include "logdump.hpp"
+#include "spsc_ring.hpp"
+#include "string_streambuf.hpp"
+
+#define AVS_RING_MAGIC		0x52535641 // "AVSR"
+// producer is done, no more data will be written
+#define AVS_RING_FLAG_EOF	(1 << 0)
+
+/*
+ * Log window shared with the producer, found at the beginning of the file
+ * or shared memory object. Data area begins at @data_offset, which is page
+ * aligned, and spans @size bytes, a power of two and multiple of the page
+ * size. @head and @tail are free-running byte counters; the producer
+ * advances @head and never waits for the consumer, which owns @tail. Data
+ * is found at (counter & (size - 1)) within the area.
+ */
+struct ring_header {
+	uint32_t magic;
+	uint32_t flags;
+	uint32_t data_offset;
+	uint32_t size;
+	uint64_t head;
+	uint64_t tail;
+};
+
+/*
+ * Maps the log window with its data area mapped twice back to back,
+ * followed by a part of the third copy, so any range up to @size bytes
+ * long, plus formatter's overreach, is contiguous regardless of where it
+ * wraps.
+ */
+class shm_ring {
+public:
+	shm_ring(const shm_ring &r) = delete;
+	shm_ring &operator=(shm_ring &r) = delete;
+
+	shm_ring();
+	~shm_ring();
+
+	// Returns 0 on success or negative error code.
+	int open(const std::string &path, size_t overreach);
+
+	uint64_t head() const
+	{
+		return __atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE);
+	}
+
+	uint64_t tail() const
+	{
+		return hdr->tail;
+	}
+
+	void set_tail(uint64_t t)
+	{
+		__atomic_store_n(&hdr->tail, t, __ATOMIC_RELEASE);
+	}
+
+	bool eof() const
+	{
+		return __atomic_load_n(&hdr->flags, __ATOMIC_ACQUIRE) & AVS_RING_FLAG_EOF;
+	}
+
+	size_t size() const
+	{
+		return hdr->size;
+	}
+
+	char *data(uint64_t counter) const
+	{
+		return data_area + (counter & (hdr->size - 1));
+	}
+
+private:
+	void release();
+
+	struct ring_header *hdr;
+	char *data_area;
+	void *base;
+	size_t length;
+};
+
+/*
+ * Decodes records straight out of the log window as the producer appends
+ * them, until the producer sets the EOF flag. Data overwritten before it
+ * got consumed is reported and skipped; if that happens while decoding,
+ * the affected text is flagged as unreliable. Text of each window is
+ * gathered first and written to @out as a whole, flushed as @fp dictates.
+ * Returns 0 on success or negative error code.
+ */
+template <class EntryT>
+int process_ring(shm_ring &ring, std::ostream &out,
+		 dictionary_slot<typename EntryT::literal_type> &slot,
+		 loss_detector *loss = nullptr, const struct flush_policy &fp = flush_policy())
+{
+	flush_controller flusher(fp);
+	uint64_t tail = ring.tail();
+	string_streambuf sb;
+	std::ostream text_out(&sb);
+	std::string text;
+	backoff wait;
+
+	sb.attach(&text);
+
+	while (true) {
+		// producer raises the flag only after its final update of head
+		bool eof = ring.eof();
+		uint64_t head = ring.head();
+		size_t consumed = 0;
+		int ret = 0;
+
+		text.clear();
+		if (head - tail > ring.size()) {
+			text_out << "Ring overrun, "
+				 << (unsigned long long)(head - ring.size() - tail)
+				 << " bytes lost\n";
+			tail = head - ring.size();
+		}
+
+		if (head - tail >= EntryT::hdr_size()) {
+			// pick up reloaded dictionary, if any, between windows
+			ret = decode_block<EntryT>(ring.data(tail), (size_t)(head - tail), tail,
+						   text_out, *slot.get(), consumed, loss);
+
+			// producer may have lapped us while decoding
+			if (ring.head() - tail > ring.size())
+				text_out << "Ring overrun while decoding, records above may be "
+					    "corrupted\n";
+		}
+
+		if (!text.empty()) {
+			out.write(text.data(), text.size());
+			flusher.written(text.size());
+		}
+		if (ret < 0) {
+			flusher.idle(out);
+			return ret;
+		}
+
+		if (consumed) {
+			tail += consumed;
+			ring.set_tail(tail);
+			wait = backoff();
+			flusher.busy(out);
+			continue;
+		}
+
+		// nothing or only an incomplete record left
+		flusher.idle(out);
+		if (eof)
+			break;
+		wait.pause();
+	}
+
+	flusher.report(std::cerr);
+	return 0;
+}
+
+#endif // AVS_SHM_RING_HPP
+
+#endif // AVS_HAVE_SHM_RING
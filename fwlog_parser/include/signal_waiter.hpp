@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_SIGNAL_WAITER_HPP
+#define AVS_SIGNAL_WAITER_HPP
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+#if defined(__linux__)
+#include <signal.h>
+#endif
+
+/*
+ * Turns termination requests - SIGINT and SIGTERM or console control
+ * events - into a call of @handler, made from a thread of its own rather
+ * than from a signal context, so the handler is free to lock and notify.
+ * On POSIX the signals are blocked in the calling thread and so in all
+ * threads it creates later on: construct the waiter before any of them.
+ * There, another signal once the handler was called terminates at once.
+ */
+class signal_waiter {
+public:
+	signal_waiter(const signal_waiter &w) = delete;
+	signal_waiter &operator=(signal_waiter &w) = delete;
+
+	explicit signal_waiter(std::function<void()> handler);
+	~signal_waiter();
+
+private:
+	std::function<void()> on_signal;
+	std::atomic<bool> exiting;
+#if defined(__linux__)
+	void run();
+
+	sigset_t set;
+	sigset_t oldset;
+	std::thread worker;
+#endif
+};
+
+#endif
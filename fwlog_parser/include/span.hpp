@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_SPAN_HPP
+#define AVS_SPAN_HPP
+
+#include <boost/cstdint.hpp>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "dictionary.hpp"
+#include "histogram.hpp"
+#include "logdump.hpp"
+
+#define AVS_SPAN_NO_ROLE UINT32_MAX
+
+// Pair of log sites, each being a key within a library.
+struct span_def {
+	std::string name;
+	uint32_t begin_lib;
+	uint64_t begin_key;
+	uint32_t end_lib;
+	uint64_t end_key;
+};
+
+/*
+ * Measures time between entries logged at begin and end sites of each
+ * span. Entries are paired within their context, e.g.: module instance
+ * and core, so interleaved executions of the same code are told apart.
+ * Sites are bound to dictionary literals, letting the scan find out
+ * whether an entry is of any interest with a single array lookup.
+ */
+template <typename LiteralT>
+class span_tracker {
+public:
+	explicit span_tracker(const std::vector<struct span_def> &d)
+		: defs(d), spans(d.size()), bound_to(nullptr)
+	{
+	}
+
+	// Binds sites to literals of @dict, unless bound to it already.
+	void bind(const dictionary<LiteralT> &dict)
+	{
+		if (bound_to == &dict)
+			return;
+
+		first_role.assign(dict.size(), AVS_SPAN_NO_ROLE);
+		roles.clear();
+
+		for (size_t i = 0; i < defs.size(); i++) {
+			add_role(dict, defs[i].begin_lib, defs[i].begin_key, i, true);
+			add_role(dict, defs[i].end_lib, defs[i].end_key, i, false);
+		}
+		bound_to = &dict;
+	}
+
+	void record(const dictionary<LiteralT> &dict, const LiteralT *literal,
+		    uint64_t context, uint64_t timestamp)
+	{
+		uint32_t r = first_role[dict.index_of(literal)];
+
+		for (; r != AVS_SPAN_NO_ROLE; r = roles[r].next) {
+			struct span_state &s = spans[roles[r].span];
+
+			if (roles[r].begin) {
+				// previous execution never reached the end site
+				if (!s.open.insert({context, timestamp}).second) {
+					s.open[context] = timestamp;
+					s.unmatched_begins++;
+				}
+				continue;
+			}
+
+			auto it = s.open.find(context);
+			if (it == s.open.end()) {
+				s.unmatched_ends++;
+				continue;
+			}
+			// timestamps may wrap or go backwards on core reset
+			if (timestamp >= it->second)
+				s.latency.add(timestamp - it->second);
+			else
+				s.negative++;
+			s.open.erase(it);
+		}
+	}
+
+	void report(std::ostream &out) const
+	{
+		for (size_t i = 0; i < defs.size(); i++) {
+			const struct span_state &s = spans[i];
+
+			out << "span " << defs[i].name << ": "
+			    << s.unmatched_begins + s.open.size() << " unmatched begins, "
+			    << s.unmatched_ends << " unmatched ends, "
+			    << s.negative << " negative\n";
+			s.latency.print(out);
+		}
+	}
+
+private:
+	struct site_role {
+		uint32_t span;
+		bool begin;
+		uint32_t next; // of the same literal
+	};
+
+	struct span_state {
+		span_state()
+			: unmatched_begins(0), unmatched_ends(0), negative(0)
+		{
+		}
+
+		// begin timestamps by context
+		std::unordered_map<uint64_t, uint64_t> open;
+		histogram latency;
+		uint64_t unmatched_begins;
+		uint64_t unmatched_ends;
+		uint64_t negative;
+	};
+
+	void add_role(const dictionary<LiteralT> &dict, uint32_t lib, uint64_t key,
+		      size_t span, bool begin)
+	{
+		const LiteralT *literal = dict.find(lib, key);
+		struct site_role role;
+
+		if (!literal)
+			throw std::invalid_argument("Site of span " + defs[span].name +
+						    " not found in dictionary");
+
+		size_t idx = dict.index_of(literal);
+
+		role.span = (uint32_t)span;
+		role.begin = begin;
+		role.next = first_role[idx];
+		first_role[idx] = (uint32_t)roles.size();
+		roles.push_back(role);
+	}
+
+	const std::vector<struct span_def> defs;
+	std::vector<struct span_state> spans;
+	std::vector<uint32_t> first_role;
+	std::vector<struct site_role> roles;
+	const dictionary<LiteralT> *bound_to;
+};
+
+/*
+ * Walks the trace feeding all recognized entries to the tracker. No text
+ * is rendered.
+ * Returns 0 on success or negative error code.
+ */
+template <class EntryT>
+int span_logdump(itrace_reader &in, dictionary_slot<typename EntryT::literal_type> &slot,
+		 span_tracker<typename EntryT::literal_type> &tracker)
+{
+	typedef typename EntryT::literal_type LiteralT;
+
+	EntryT entry;
+
+	return scan_logdump<EntryT>(in, [&](char *buf, size_t len, uint64_t base,
+					    size_t &consumed) {
+		const dictionary<LiteralT> &dict = *slot.get();
+
+		tracker.bind(dict);
+
+		return walk_block<EntryT>(buf, len, dict, consumed,
+					  [&](char *ptr, const struct record_index &rec,
+					      const LiteralT *literal) {
+			if (literal) {
+				entry.assign_ptr(ptr);
+				tracker.record(dict, literal, entry.context(), entry.timestamp());
+			}
+			return 0;
+		});
+	});
+}
+
+#endif
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_SPSC_RING_HPP
+#define AVS_SPSC_RING_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#define AVS_CACHELINE_SIZE 64
+// attempts to pop an item before the consumer blocks
+#define AVS_SPSC_SPIN 128
+
+/*
+ * Bounded lock-free queue for exactly one producer and one consumer
+ * thread. Capacity must be a power of two.
+ * Consumer may also block till an item shows up, the producer wakes it
+ * up only if it is actually waiting, so pushes stay lock-free otherwise.
+ */
+template <typename T>
+class spsc_ring {
+public:
+	spsc_ring(const spsc_ring &r) = delete;
+	spsc_ring &operator=(spsc_ring &r) = delete;
+
+	explicit spsc_ring(size_t capacity)
+		: items(capacity), mask(capacity - 1), head(0), tail(0), waiting(false)
+	{
+		if (!capacity || (capacity & mask))
+			throw std::invalid_argument("ring capacity must be a power of two");
+	}
+
+	// producer only
+	bool push(const T &item)
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+
+		if (t - head.load(std::memory_order_acquire) == items.size())
+			return false;
+
+		items[t & mask] = item;
+		tail.store(t + 1, std::memory_order_release);
+
+		// pairs with the fence of pop_wait(), either the consumer sees
+		// the item or the producer sees the consumer waiting
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (waiting.load(std::memory_order_relaxed))
+			wake();
+		return true;
+	}
+
+	// consumer only
+	bool pop(T &item)
+	{
+		size_t h = head.load(std::memory_order_relaxed);
+
+		if (h == tail.load(std::memory_order_acquire))
+			return false;
+
+		item = items[h & mask];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	/*
+	 * Consumer only. Pops an item, spinning shortly and then blocking
+	 * till one is pushed, @stop is raised or @timeout passes, if it is
+	 * not zero. Whoever raises @stop has to call wake() afterwards.
+	 * Returns false if no item was popped.
+	 */
+	bool pop_wait(T &item, const std::atomic<bool> &stop,
+		      std::chrono::milliseconds timeout = std::chrono::milliseconds(0))
+	{
+		std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+		bool ret;
+
+		for (int i = 0; i < AVS_SPSC_SPIN; i++) {
+			if (pop(item))
+				return true;
+			if (stop)
+				return false;
+			std::this_thread::yield();
+		}
+
+		lock.lock();
+		waiting.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if (timeout.count()) {
+			auto until = std::chrono::steady_clock::now() + timeout;
+
+			while (!(ret = pop(item)) && !stop &&
+			       cond.wait_until(lock, until) != std::cv_status::timeout)
+				;
+		} else {
+			while (!(ret = pop(item)) && !stop)
+				cond.wait(lock);
+		}
+		if (!ret)
+			ret = pop(item);
+
+		waiting.store(false, std::memory_order_relaxed);
+		return ret;
+	}
+
+	// Wakes the consumer up if it is blocked in pop_wait().
+	void wake()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		cond.notify_one();
+	}
+
+	size_t size() const
+	{
+		return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+	}
+
+private:
+	std::vector<T> items;
+	const size_t mask;
+
+	// keep indexes on separate lines so producer and consumer do not
+	// invalidate each other's cache
+	alignas(AVS_CACHELINE_SIZE) std::atomic<size_t> head;
+	alignas(AVS_CACHELINE_SIZE) std::atomic<size_t> tail;
+
+	// consumer is blocked or about to block
+	alignas(AVS_CACHELINE_SIZE) std::atomic<bool> waiting;
+	std::mutex mutex;
+	std::condition_variable cond;
+};
+
+/*
+ * Waits with progressively longer pauses, so a stage that keeps waiting
+ * costs little CPU while a short wait does not involve the scheduler.
+ */
+class backoff {
+public:
+	backoff()
+		: rounds(0)
+	{
+	}
+
+	void pause()
+	{
+		if (rounds < 64) {
+			rounds++;
+		} else if (rounds < 128) {
+			rounds++;
+			std::this_thread::yield();
+		} else {
+			std::this_thread::sleep_for(std::chrono::microseconds(500));
+		}
+	}
+
+private:
+	unsigned int rounds;
+};
+
+#endif
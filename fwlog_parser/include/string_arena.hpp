@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_STRING_ARENA_HPP
+#define AVS_STRING_ARENA_HPP
+
+#include <boost/cstdint.hpp>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+/*
+ * Single buffer of NUL-terminated strings referenced by their offsets.
+ * Identical strings are stored only once - filenames, providers and log
+ * levels repeat for thousands of dictionary entries.
+ */
+class string_arena {
+public:
+	string_arena(const string_arena &a) = delete;
+	string_arena &operator=(string_arena &a) = delete;
+
+	string_arena();
+
+	// Returns offset of the string, storing it first if not present yet.
+	// String is cut at the first '\0', if any, within given length.
+	uint32_t intern(const char *str, size_t len);
+
+	uint32_t intern(const std::string &str)
+	{
+		return intern(str.data(), str.size());
+	}
+
+	const char *c_str(uint32_t offset) const
+	{
+		return buf.data() + offset;
+	}
+
+	size_t size() const
+	{
+		return buf.size();
+	}
+
+	// Appends all strings of @other as they are, none of them gets
+	// interned. Returns offset the strings of @other start at.
+	uint32_t append(const string_arena &other);
+
+	// Releases memory needed for interning only, once no more strings
+	// are going to be added.
+	void seal();
+
+private:
+	struct hasher {
+		size_t operator()(uint32_t offset) const;
+		const std::vector<char> *buf;
+	};
+
+	struct equal {
+		bool operator()(uint32_t a, uint32_t b) const;
+		const std::vector<char> *buf;
+	};
+
+	std::vector<char> buf;
+	std::unordered_set<uint32_t, hasher, equal> index;
+};
+
+#endif
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_STRING_STREAMBUF_HPP
+#define AVS_STRING_STREAMBUF_HPP
+
+#include <streambuf>
+#include <string>
+
+// Appends everything written to the stream to the attached string.
+class string_streambuf : public std::streambuf {
+public:
+	string_streambuf()
+		: str(nullptr)
+	{
+	}
+
+	void attach(std::string *s)
+	{
+		str = s;
+	}
+
+protected:
+	virtual int_type overflow(int_type c) override
+	{
+		if (!traits_type::eq_int_type(c, traits_type::eof()))
+			str->push_back(traits_type::to_char_type(c));
+		return traits_type::not_eof(c);
+	}
+
+	virtual std::streamsize xsputn(const char *s, std::streamsize n) override
+	{
+		str->append(s, (size_t)n);
+		return n;
+	}
+
+private:
+	std::string *str;
+};
+
+#endif
@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_TEXT_TEMPLATE_HPP
+#define AVS_TEXT_TEMPLATE_HPP
+
+#include <string>
+
+/*
+ * Template is the text of a record as known before its data is seen, with
+ * each variable part replaced by a marker. Number stands for any run of
+ * characters a printed integer is made of, padding included; any stands
+ * for arbitrary text.
+ */
+#define AVS_TEMPLATE_NUMBER	'\x01'
+#define AVS_TEMPLATE_ANY	'\x02'
+
+// Appends template of the text printf() produces given @fmt.
+void printf_template(std::string &tmpl, const char *fmt);
+
+// Whether any text matching @tmpl may contain @needle.
+bool template_may_contain(const std::string &tmpl, const std::string &needle);
+
+#endif
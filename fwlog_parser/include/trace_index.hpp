@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_TRACE_INDEX_HPP
+#define AVS_TRACE_INDEX_HPP
+
+#include <boost/cstdint.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "dictionary.hpp"
+#include "itrace_reader.hpp"
+#include "logdump.hpp"
+
+#define AVS_INDEX_MAGIC		0x49535641 // "AVSI"
+#define AVS_INDEX_VERSION	3
+// records closer than that are read at once, in bytes
+#define AVS_INDEX_READ_GAP	4096
+
+/*
+ * Trace and dictionary the index was built from. The trace is probed
+ * rather than hashed whole: only the last AVS_CHECKPOINT_PROBE_SIZE bytes
+ * preceding trace_size are hashed, see trace_identity(), so rewrites
+ * of the data before them are caught by the modification time alone.
+ */
+struct index_identity {
+	uint64_t trace_size;
+	uint64_t trace; // hash of the probe
+	int64_t mtime; // modification time of the trace, in seconds
+	uint64_t dictionary; // fingerprint
+};
+
+// Records to be selected, empty criteria match any record.
+struct index_selection {
+	index_selection()
+		: from(0), to(UINT64_MAX)
+	{
+	}
+
+	std::vector<uint32_t> libs;
+	std::vector<std::pair<uint32_t, uint64_t>> sites; // lib_id and key
+	std::vector<uint32_t> cores;
+	uint64_t from; // timestamp range, inclusive
+	uint64_t to;
+};
+
+// First row of the records whose offsets share the high 32 bits.
+struct offset_base {
+	uint32_t row;
+	uint32_t high;
+};
+
+/*
+ * Sidecar of the trace, a column per record attribute. Records known to
+ * the dictionary are the only ones indexed, in the order found in the
+ * trace. Selecting records scans the columns criterion by criterion with
+ * loops simple enough to be vectorized, so the framing pass is needed
+ * only once per trace.
+ * Columns are kept narrow: only the low 32 bits of offsets are stored per
+ * record, along with rows the high ones change at, and keys are packed
+ * by EntryT::pack_key().
+ * On disk, the header is followed by the bases and then the columns in
+ * order of declaration, each one an array of the header's count of
+ * elements.
+ */
+class trace_index {
+public:
+	void add(uint64_t offset, uint64_t timestamp, uint32_t key, uint32_t lib_id,
+		 uint32_t length, uint32_t core)
+	{
+		uint32_t high = (uint32_t)(offset >> 32);
+
+		if (high != (bases.empty() ? 0 : bases.back().high))
+			bases.push_back({ (uint32_t)size(), high });
+
+		offsets.push_back((uint32_t)offset);
+		timestamps.push_back(timestamp);
+		keys.push_back(key);
+		lib_ids.push_back((uint8_t)lib_id);
+		lengths.push_back((uint8_t)length);
+		cores.push_back((uint8_t)core);
+	}
+
+	size_t size() const
+	{
+		return offsets.size();
+	}
+
+	uint64_t offset(size_t row) const
+	{
+		auto it = std::upper_bound(bases.begin(), bases.end(), row,
+					   [](size_t r, const struct offset_base &b) {
+			return r < b.row;
+		});
+		uint64_t high = it == bases.begin() ? 0 : (it - 1)->high;
+
+		return high << 32 | offsets[row];
+	}
+
+	// Returns 0 on success or negative error code.
+	int save(const std::string &path, const struct index_identity &id) const;
+	// Returns 0 on success, -ENOENT if there is no index or other negative
+	// error code.
+	int load(const std::string &path, struct index_identity &id);
+
+	// Stores rows of records matching @sel in @rows, in trace order. Keys
+	// of sites are expected packed.
+	void select(const struct index_selection &sel, std::vector<uint32_t> &rows) const;
+
+	std::vector<struct offset_base> bases;
+	std::vector<uint32_t> offsets; // low 32 bits, see offset()
+	std::vector<uint64_t> timestamps;
+	std::vector<uint32_t> keys;
+	std::vector<uint8_t> lib_ids;
+	std::vector<uint8_t> lengths;
+	std::vector<uint8_t> cores;
+};
+
+/*
+ * Frames the whole trace and indexes all records known to the dictionary.
+ * Rows are 32-bit, traces of more records fail with -EFBIG.
+ * Returns 0 on success or negative error code.
+ */
+template <class EntryT>
+int build_index(itrace_reader &in, const dictionary<typename EntryT::literal_type> &dict,
+		trace_index &index)
+{
+	typedef typename EntryT::literal_type LiteralT;
+
+	static_assert(EntryT::max_size() <= UINT8_MAX, "entries too large to be indexed");
+
+	EntryT entry;
+
+	return scan_logdump<EntryT>(in, [&](char *buf, size_t len, uint64_t base,
+					    size_t &consumed) {
+		return walk_block<EntryT>(buf, len, dict, consumed,
+					  [&](char *ptr, const struct record_index &rec,
+					      const LiteralT *literal) {
+			if (!literal)
+				return 0;
+			if (index.size() >= UINT32_MAX)
+				return -EFBIG;
+
+			entry.assign_ptr(ptr);
+			index.add(base + rec.pos, entry.timestamp(), EntryT::pack_key(rec.key),
+				  rec.lib_id, (uint32_t)EntryT::size((unsigned char)*ptr),
+				  entry.core_id());
+			return 0;
+		});
+	});
+}
+
+/*
+ * Decodes records at @rows of the index, reading nothing of the trace but
+ * their data. Records less than AVS_INDEX_READ_GAP apart are fetched with
+ * a single read. Amount of data read is stored in @read.
+ * Returns 0 on success or negative error code.
+ */
+template <class EntryT>
+int query_index(std::istream &in, const trace_index &index, const std::vector<uint32_t> &rows,
+		std::ostream &out, const dictionary<typename EntryT::literal_type> &dict,
+		uint64_t &read)
+{
+	std::vector<char> block;
+	EntryT entry;
+	size_t i = 0;
+
+	read = 0;
+	while (i < rows.size()) {
+		uint64_t begin = index.offset(rows[i]);
+		uint64_t end = begin + index.lengths[rows[i]];
+		size_t j;
+
+		for (j = i + 1; j < rows.size(); j++) {
+			uint64_t offset = index.offset(rows[j]);
+			uint64_t next = offset + index.lengths[rows[j]];
+
+			if (offset > end + AVS_INDEX_READ_GAP || next - begin > AVS_CHUNK_SIZE)
+				break;
+			end = std::max(end, next);
+		}
+
+		// formatters may access payload beyond the entry
+		block.assign(end - begin + EntryT::max_size(), 0);
+		in.seekg((std::streamoff)begin);
+		in.read(block.data(), end - begin);
+		if ((uint64_t)in.gcount() != end - begin)
+			return -ENODATA; // trace shrunk since indexed
+		read += end - begin;
+
+		for (; i < j; i++) {
+			char *ptr = block.data() + (index.offset(rows[i]) - begin);
+			const typename EntryT::literal_type *literal;
+			int ret;
+
+			literal = dict.find(index.lib_ids[rows[i]],
+					    EntryT::unpack_key(index.keys[rows[i]]));
+			if (!literal)
+				continue;
+
+			entry.assign_ptr(ptr);
+			ret = write_entry(out, dict.strings(), literal, entry,
+					  (uint32_t *)(ptr + EntryT::hdr_size()));
+			if (ret < 0)
+				return ret;
+		}
+	}
+
+	return 0;
+}
+
+#endif
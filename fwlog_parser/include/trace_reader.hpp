@@ -0,0 +1,19 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_TRACE_READER_HPP
+#define AVS_TRACE_READER_HPP
+
+#include <memory>
+#include <string>
+#include "itrace_reader.hpp"
+
+// Opens the trace with the most efficient reader available on the host.
+std::unique_ptr<itrace_reader> open_trace_reader(const std::string &path);
+
+#endif
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_TRACE_READER_STREAM_HPP
+#define AVS_TRACE_READER_STREAM_HPP
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include "itrace_reader.hpp"
+
+// Portable reader built on top of std::ifstream.
+class trace_reader_stream : public itrace_reader {
+public:
+	trace_reader_stream();
+
+	virtual int open(const std::string &path) override;
+	virtual int next(const char **data, size_t *len) override;
+
+	virtual uint64_t tell() const override
+	{
+		return offset;
+	}
+
+	virtual void seek(uint64_t off) override;
+
+private:
+	std::ifstream file;
+	std::unique_ptr<char[]> buf;
+	uint64_t offset;
+	bool reposition;
+};
+
+#endif
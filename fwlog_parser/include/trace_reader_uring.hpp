@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define AVS_HAVE_IO_URING
+#endif
+#endif
+
+#if defined(AVS_HAVE_IO_URING)
+
+#ifndef AVS_TRACE_READER_URING_HPP
+#define AVS_TRACE_READER_URING_HPP
+
+#include <linux/io_uring.h>
+#include <string>
+#include "itrace_reader.hpp"
+
+// number of reads kept in flight
+#define AVS_URING_DEPTH 16
+
+/*
+ * Reader which keeps a queue of chunk-sized reads in flight ahead of the
+ * consumer, with buffers registered to the kernel up front. Once the end
+ * of file is hit, reads queued past it are dropped and only a single one
+ * is kept in flight till full chunks show up again, so following a file
+ * growing slowly does not cost the whole queue per update.
+ */
+class trace_reader_uring : public itrace_reader {
+public:
+	trace_reader_uring();
+	virtual ~trace_reader_uring();
+
+	virtual int open(const std::string &path) override;
+	virtual int next(const char **data, size_t *len) override;
+
+	virtual uint64_t tell() const override
+	{
+		return offset;
+	}
+
+	virtual void seek(uint64_t off) override;
+
+private:
+	struct read_slot {
+		int res;
+		bool busy;
+		bool done;
+	};
+
+	int setup();
+	void submit(unsigned int slot, uint64_t off);
+	int enter(unsigned int min_complete);
+	void reap();
+	int wait(unsigned int slot);
+	int fill();
+	int drain();
+	void release();
+
+	int ring_fd;
+	int file_fd;
+	bool fixed; // whether buffers got registered
+
+	void *sq_ring;
+	size_t sq_ring_size;
+	void *cq_ring;
+	size_t cq_ring_size;
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+	unsigned int *sq_tail;
+	unsigned int *sq_mask;
+	unsigned int *sq_array;
+	unsigned int *cq_head;
+	unsigned int *cq_tail;
+	unsigned int *cq_mask;
+	struct io_uring_cqe *cqes;
+	unsigned int to_submit;
+
+	char *buffers;
+	struct read_slot slots[AVS_URING_DEPTH];
+	unsigned int head; // slot holding data found at offset
+	unsigned int queued; // slots from head on, reading consecutive chunks
+	unsigned int depth; // slots to be queued
+	uint64_t offset;
+	bool eof;
+};
+
+#endif // AVS_TRACE_READER_URING_HPP
+
+#endif // AVS_HAVE_IO_URING
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <boost/filesystem/operations.hpp>
+#include <cerrno>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "checkpoint.hpp"
+
+#define CHECKPOINT_MAGIC	"avsfwlog-checkpoint"
+#define CHECKPOINT_VERSION	1
+
+#define FNV_PRIME		0x100000001b3ULL
+
+uint64_t fnv1a(uint64_t hash, const void *data, size_t len)
+{
+	const unsigned char *p = (const unsigned char *)data;
+
+	for (size_t i = 0; i < len; i++) {
+		hash ^= p[i];
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+int load_checkpoint(const std::string &path, struct checkpoint &cp)
+{
+	std::ifstream file(path);
+	std::string magic, identity, offset, timestamp, output, dictionary;
+	int version;
+
+	if (!file.is_open())
+		return -ENOENT;
+
+	file >> magic >> version;
+	if (file.fail() || magic != CHECKPOINT_MAGIC || version != CHECKPOINT_VERSION)
+		return -EINVAL;
+
+	// every field is labeled for the sake of those reading it
+	file >> identity >> std::hex >> cp.identity
+	     >> offset >> std::dec >> cp.offset
+	     >> timestamp >> cp.timestamp
+	     >> output >> cp.output
+	     >> dictionary >> std::hex >> cp.dictionary;
+	if (file.fail() || identity != "identity" || offset != "offset" ||
+	    timestamp != "timestamp" || output != "output" || dictionary != "dictionary")
+		return -EINVAL;
+
+	return 0;
+}
+
+int save_checkpoint(const std::string &path, const struct checkpoint &cp)
+{
+	std::string tmppath = path + ".tmp";
+	boost::system::error_code ec;
+
+	{
+		std::ofstream file(tmppath, std::ios::trunc);
+
+		file << CHECKPOINT_MAGIC << " " << CHECKPOINT_VERSION << "\n"
+		     << "identity " << std::hex << cp.identity << "\n"
+		     << "offset " << std::dec << cp.offset << "\n"
+		     << "timestamp " << cp.timestamp << "\n"
+		     << "output " << cp.output << "\n"
+		     << "dictionary " << std::hex << cp.dictionary << "\n";
+		file.close();
+		if (file.fail())
+			return -EIO;
+	}
+
+	// replaces existing file on all platforms, unlike std::rename()
+	boost::filesystem::rename(tmppath, path, ec);
+	if (ec)
+		return -ec.value();
+	return 0;
+}
+
+int trace_identity(const std::string &path, uint64_t offset, uint64_t &identity)
+{
+	std::ifstream file(path, std::ios::binary);
+	size_t len = offset < AVS_CHECKPOINT_PROBE_SIZE ? (size_t)offset :
+			 AVS_CHECKPOINT_PROBE_SIZE;
+	std::vector<char> buf(len);
+
+	if (!file.is_open())
+		return -ENOENT;
+
+	file.seekg((std::streamoff)(offset - len));
+	file.read(buf.data(), len);
+	if ((size_t)file.gcount() != len)
+		return -ESPIPE;
+
+	identity = fnv1a(AVS_FNV_OFFSET_BASIS, buf.data(), len);
+	return 0;
+}
+
+int checkpointer::save(const struct checkpoint &cp)
+{
+	struct checkpoint next = cp;
+	int ret;
+
+	last_save = std::chrono::steady_clock::now();
+	// trace may stay quiet for hours, spare rewriting the same progress
+	if (cp.offset == current.offset && cp.output == current.output &&
+	    cp.dictionary == current.dictionary)
+		return 0;
+
+	ret = trace_identity(tracepath, next.offset, next.identity);
+	if (ret < 0)
+		return ret;
+
+	ret = save_checkpoint(path, next);
+	if (ret < 0)
+		return ret;
+
+	current = next;
+	return 0;
+}
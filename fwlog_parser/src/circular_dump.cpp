@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include "circular_dump.hpp"
+
+circular_reader::circular_reader(std::unique_ptr<itrace_reader> reader,
+				 const struct circular_window &win)
+	: in(std::move(reader)), window(win), offset(win.begin)
+{
+}
+
+int circular_reader::open(const std::string &path)
+{
+	offset = window.begin;
+	return in->open(path);
+}
+
+int circular_reader::next(const char **data, size_t *len)
+{
+	uint64_t end = window.begin + window.length;
+	uint64_t pos, avail;
+	int ret;
+
+	*len = 0;
+	if (offset >= end)
+		return 0;
+
+	pos = offset < window.size ? offset : offset - window.size;
+	// reads are sequential but for the jump back to the beginning
+	if (in->tell() != pos)
+		in->seek(pos);
+
+	ret = in->next(data, len);
+	if (ret < 0)
+		return ret;
+
+	// stop at the end of the window, data beyond is not a part of it
+	avail = std::min(window.size - pos, end - offset);
+	if (*len > avail)
+		*len = (size_t)avail;
+	offset += *len;
+	return 0;
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include "demux.hpp"
+
+demux_writer::demux_writer(const std::string &p, enum demux_by b)
+	: prefix(p), by(b)
+{
+}
+
+static std::string stream_name(enum demux_by by, uint64_t id)
+{
+	if (id == AVS_DEMUX_UNKNOWN)
+		return "unknown";
+
+	switch (by) {
+	case DEMUX_CORE:
+		return "core" + std::to_string(id);
+	case DEMUX_LIB:
+		return "lib" + std::to_string(id);
+	default:
+		return "module" + std::to_string(id >> 16) + "_" + std::to_string(id & 0xffff);
+	}
+}
+
+struct demux_writer::output *demux_writer::get(uint64_t id)
+{
+	auto it = outputs.find(id);
+
+	if (it != outputs.end())
+		return it->second.get();
+
+	struct output *o = new output;
+
+	o->path = prefix + "." + stream_name(by, id);
+	o->created = false;
+	o->lru = open_files.end();
+	outputs[id].reset(o);
+	return o;
+}
+
+void demux_writer::close_oldest()
+{
+	struct output *victim = open_files.front();
+
+	victim->file.close();
+	victim->lru = open_files.end();
+	open_files.pop_front();
+}
+
+void demux_writer::flush(struct output &o)
+{
+	if (o.lru == open_files.end()) {
+		if (open_files.size() >= AVS_DEMUX_MAX_OPEN)
+			close_oldest();
+
+		while (true) {
+			o.file.clear();
+			o.file.open(o.path, o.created ? std::ios_base::app : std::ios_base::trunc);
+			if (o.file.is_open())
+				break;
+			// descriptors may run out before the limit is reached
+			if (open_files.empty())
+				throw std::runtime_error("Failed to open " + o.path);
+			close_oldest();
+		}
+		o.created = true;
+		o.lru = open_files.insert(open_files.end(), &o);
+	} else {
+		open_files.splice(open_files.end(), open_files, o.lru);
+	}
+
+	o.file.write(o.buf.data(), o.buf.size());
+	if (o.file.fail())
+		throw std::runtime_error("Failed to write " + o.path);
+	o.buf.clear();
+}
+
+void demux_writer::write(uint64_t id, const char *text, size_t len)
+{
+	struct output *o = get(id);
+
+	o->buf.append(text, len);
+	if (o->buf.size() >= AVS_DEMUX_BUFFER_SIZE)
+		flush(*o);
+}
+
+void demux_writer::close()
+{
+	for (auto it = outputs.begin(); it != outputs.end(); it++)
+		if (!it->second->buf.empty())
+			flush(*it->second);
+
+	for (auto it = open_files.begin(); it != open_files.end(); it++) {
+		(*it)->file.close();
+		(*it)->lru = open_files.end();
+	}
+	open_files.clear();
+}
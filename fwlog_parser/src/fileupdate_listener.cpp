@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <memory>
+#include <string>
+#include "fileupdate_listener.hpp"
+
+#if defined(__linux__)
+#include "fileupdate_listener_linux.hpp"
+#include "fileupdate_listener_poll.hpp"
+
+std::unique_ptr<ifileupdate_listener> open_fileupdate_listener(const std::string &fullpath)
+{
+	std::unique_ptr<ifileupdate_listener> listener;
+
+	if (inotify_visible(fullpath)) {
+		listener.reset(new fileupdate_listener_linux());
+		if (listener->subscribe(fullpath))
+			return listener;
+	}
+
+	// polling sees every file, only slower
+	listener.reset(new fileupdate_listener_poll());
+	if (!listener->subscribe(fullpath))
+		listener.reset();
+	return listener;
+}
+
+#elif defined(_WIN32) || defined (__CYGWIN__)
+#include "fileupdate_listener_win.hpp"
+
+std::unique_ptr<ifileupdate_listener> open_fileupdate_listener(const std::string &fullpath)
+{
+	std::unique_ptr<ifileupdate_listener> listener(new fileupdate_listener_win());
+
+	if (!listener->subscribe(fullpath))
+		listener.reset();
+	return listener;
+}
+#endif
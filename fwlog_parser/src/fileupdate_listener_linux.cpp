@@ -9,13 +9,17 @@
 #if defined(__linux__)
 
 #include <boost/filesystem/path.hpp>
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <string>
 
 #include <errno.h>
 #include <fcntl.h>
+#include <sys/eventfd.h>
 #include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
 #include <unistd.h>
 #include "fileupdate_listener_linux.hpp"
 
@@ -23,14 +27,47 @@
 // inotify_event instances returned to read()
 #define BUF_LEN ((sizeof(struct inotify_event) + FILENAME_MAX) * 1024)
 
+// Tells whether writes to the file are reported by inotify. Filesystems
+// generating the content themselves or receiving it over the network
+// do not report them.
+bool inotify_visible(const std::string &fullpath)
+{
+	static const unsigned long blind[] = {
+		0x64626720, // debugfs
+		0x74726163, // tracefs
+		0x62656572, // sysfs
+		0x9fa0, // procfs
+		0x6969, // NFS
+		0x517b, // SMB
+		0xff534d42, // CIFS
+		0xfe534d42, // SMB2
+		0x65735546, // FUSE
+	};
+	struct statfs sfs;
+	struct stat st;
+
+	if (stat(fullpath.c_str(), &st) < 0 || !S_ISREG(st.st_mode))
+		return false;
+	if (statfs(fullpath.c_str(), &sfs) < 0)
+		return false;
+
+	for (size_t i = 0; i < sizeof(blind) / sizeof(*blind); i++)
+		if ((unsigned long)sfs.f_type == blind[i])
+			return false;
+	return true;
+}
+
 fileupdate_listener_linux::fileupdate_listener_linux()
 {
 	fd = inotify_init();
 	if (fd < 0)
 		std::cerr << "inotify_init failed: " << errno << std::endl;
+	efd = eventfd(0, EFD_CLOEXEC);
+	if (efd < 0)
+		std::cerr << "eventfd failed: " << errno << std::endl;
 
 	FD_ZERO(&readfds);
-	wd = EINVAL;
+	wd = -EINVAL;
 }
 
 fileupdate_listener_linux::~fileupdate_listener_linux()
@@ -40,6 +77,7 @@ fileupdate_listener_linux::~fileupdate_listener_linux()
 	int ret = close(fd);
 	if (ret)
 		std::cerr << "close failed: " << errno << std::endl;
+	close(efd);
 }
 
 bool fileupdate_listener_linux::subscribe(const std::string &fullpath)
@@ -49,8 +87,10 @@ bool fileupdate_listener_linux::subscribe(const std::string &fullpath)
 
 	boost::filesystem::path p(fullpath);
 	filename = p.filename().string();
+	// bare file name refers to the working directory
+	std::string dir = p.has_parent_path() ? p.parent_path().string() : ".";
 
-	wd = inotify_add_watch(fd, p.parent_path().c_str(), IN_MODIFY);
+	wd = inotify_add_watch(fd, dir.c_str(), IN_MODIFY);
 	if (wd < 0) {
 		std::cerr << "inotify_add_watch failed: " << errno << std::endl;
 		return false;
@@ -65,20 +105,30 @@ void fileupdate_listener_linux::__unsubscribe()
 		return; // nothing to do
 	if (inotify_rm_watch(fd, wd))
 		std::cerr << "inotify_rm_watch failed: " << errno << std::endl;
-	wd = EINVAL;
+	wd = -EINVAL;
 }
 
 int fileupdate_listener_linux::wait_for_signal()
 {
+again:
+	FD_ZERO(&readfds);
 	FD_SET(fd, &readfds);
+	FD_SET(efd, &readfds);
 
-again:
-	int ret = select(fd + 1, &readfds, NULL, NULL, NULL);
+	int ret = select(std::max(fd, efd) + 1, &readfds, NULL, NULL, NULL);
 	if (ret < 0) {
 		std::cerr << "select failed: " << errno << std::endl;
 		return errno;
 	}
 
+	if (FD_ISSET(efd, &readfds)) {
+		uint64_t count;
+
+		if (read(efd, &count, sizeof(count)) < 0)
+			std::cerr << "eventfd read failed: " << errno << std::endl;
+		return EINTR;
+	}
+
 	if (!FD_ISSET(fd, &readfds))
 		goto again; // no events to process
 
@@ -100,4 +150,12 @@ again:
 	goto again;
 }
 
+void fileupdate_listener_linux::interrupt()
+{
+	uint64_t count = 1;
+
+	if (write(efd, &count, sizeof(count)) < 0)
+		std::cerr << "eventfd write failed: " << errno << std::endl;
+}
+
 #endif
\ No newline at end of file
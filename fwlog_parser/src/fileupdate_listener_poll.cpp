@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#if defined(__linux__)
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include "fileupdate_listener_poll.hpp"
+
+fileupdate_listener_poll::fileupdate_listener_poll()
+	: interval(AVS_POLL_MIN_INTERVAL), offset(0), advanced(false), sized(false)
+{
+	tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	if (tfd < 0)
+		std::cerr << "timerfd_create failed: " << errno << std::endl;
+	efd = eventfd(0, EFD_CLOEXEC);
+	if (efd < 0)
+		std::cerr << "eventfd failed: " << errno << std::endl;
+}
+
+fileupdate_listener_poll::~fileupdate_listener_poll()
+{
+	if (tfd >= 0)
+		close(tfd);
+	if (efd >= 0)
+		close(efd);
+}
+
+bool fileupdate_listener_poll::subscribe(const std::string &fullpath)
+{
+	if (tfd < 0 || efd < 0)
+		return false;
+
+	path = fullpath;
+	interval = AVS_POLL_MIN_INTERVAL;
+	return true;
+}
+
+void fileupdate_listener_poll::unsubscribe()
+{
+	path.clear();
+}
+
+void fileupdate_listener_poll::drained(uint64_t off)
+{
+	advanced = off != offset;
+	offset = off;
+}
+
+bool poll_file_changed(const std::string &path, uint64_t offset, bool &sized)
+{
+	struct stat st;
+
+	if (stat(path.c_str(), &st) < 0)
+		return true; // let the reader tell what happened
+
+	// size matching what was read is trusted to report growth, any other
+	// says nothing - zero of debugfs nodes, page size of sysfs ones
+	sized = S_ISREG(st.st_mode) && (uint64_t)st.st_size == offset;
+	return !sized;
+}
+
+int fileupdate_listener_poll::arm()
+{
+	struct itimerspec its = {};
+
+	its.it_value.tv_sec = interval / 1000;
+	its.it_value.tv_nsec = (interval % 1000) * 1000000;
+	if (timerfd_settime(tfd, 0, &its, NULL) < 0) {
+		std::cerr << "timerfd_settime failed: " << errno << std::endl;
+		return errno;
+	}
+	return 0;
+}
+
+int fileupdate_listener_poll::wait_for_signal()
+{
+	struct pollfd fds[2] = {
+		{ tfd, POLLIN, 0 },
+		{ efd, POLLIN, 0 },
+	};
+	int ret;
+
+	// previous tick brought nothing, no point in retrying at the same pace
+	if (advanced)
+		interval = AVS_POLL_MIN_INTERVAL;
+	else if (!sized)
+		interval = std::min<uint64_t>(interval * 2, AVS_POLL_MAX_INTERVAL);
+	advanced = false;
+
+	for (;;) {
+		ret = arm();
+		if (ret)
+			return ret;
+
+		ret = poll(fds, 2, -1);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			std::cerr << "poll failed: " << errno << std::endl;
+			return errno;
+		}
+
+		if (fds[1].revents) {
+			uint64_t count;
+
+			if (read(efd, &count, sizeof(count)) < 0)
+				std::cerr << "eventfd read failed: " << errno << std::endl;
+			return EINTR;
+		}
+
+		if (fds[0].revents) {
+			uint64_t expirations;
+
+			if (read(tfd, &expirations, sizeof(expirations)) < 0)
+				std::cerr << "timerfd read failed: " << errno << std::endl;
+			if (poll_file_changed(path, offset, sized))
+				return 0;
+			interval = std::min<uint64_t>(interval * 2, AVS_POLL_MAX_INTERVAL);
+		}
+	}
+}
+
+void fileupdate_listener_poll::interrupt()
+{
+	uint64_t count = 1;
+
+	if (write(efd, &count, sizeof(count)) < 0)
+		std::cerr << "eventfd write failed: " << errno << std::endl;
+}
+
+#endif
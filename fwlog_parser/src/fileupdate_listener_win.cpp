@@ -19,6 +19,7 @@ fileupdate_listener_win::fileupdate_listener_win()
 {
 	hFile = INVALID_HANDLE_VALUE;
 	hEvent = nullptr;
+	interrupted = 0;
 	buffer = new unsigned char[AVS_NOTIFY_BUFFER_SIZE];
 	// hEvent is unused by the system if lpCompletionRoutine is provided
 	// in ReadDirectoryChangesW
@@ -75,7 +76,10 @@ bool fileupdate_listener_win::subscribe(const std::string &fullpath)
 	MultiByteToWideChar(CP_ACP, 0, str.c_str(), (int)str.size(), &wstr[0], count);
 	filename = wstr;
 
-	hFile = CreateFile(p.parent_path().c_str(), FILE_LIST_DIRECTORY,
+	// bare file name refers to the working directory
+	boost::filesystem::path dir = p.has_parent_path() ? p.parent_path() : ".";
+
+	hFile = CreateFile(dir.c_str(), FILE_LIST_DIRECTORY,
 			   FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
 			   NULL, OPEN_EXISTING,
 			   FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
@@ -127,7 +131,16 @@ int fileupdate_listener_win::wait_for_signal()
 	} while (ret == WAIT_IO_COMPLETION);
 
 	ResetEvent(hEvent);
+	if (InterlockedExchange(&interrupted, 0))
+		return ERROR_OPERATION_ABORTED;
 	return ret;
 }
 
+void fileupdate_listener_win::interrupt()
+{
+	InterlockedExchange(&interrupted, 1);
+	if (hEvent)
+		SetEvent(hEvent);
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "fileupdate_watch_set.hpp"
+
+#if defined(AVS_HAVE_WATCH_SET)
+
+#include <boost/filesystem/path.hpp>
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include "fileupdate_listener_linux.hpp"
+#include "fileupdate_listener_poll.hpp"
+
+// buffer should be large enough to hold a range of
+// inotify_event instances returned to read()
+#define BUF_LEN ((sizeof(struct inotify_event) + FILENAME_MAX) * 1024)
+
+fileupdate_watch_set::fileupdate_watch_set()
+	: interval(AVS_POLL_MIN_INTERVAL)
+{
+	fd = inotify_init1(IN_CLOEXEC);
+	if (fd < 0)
+		std::cerr << "inotify_init failed: " << errno << std::endl;
+	tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	if (tfd < 0)
+		std::cerr << "timerfd_create failed: " << errno << std::endl;
+	efd = eventfd(0, EFD_CLOEXEC);
+	if (efd < 0)
+		std::cerr << "eventfd failed: " << errno << std::endl;
+}
+
+fileupdate_watch_set::~fileupdate_watch_set()
+{
+	// closing the instance drops all its watches
+	if (fd >= 0)
+		close(fd);
+	if (tfd >= 0)
+		close(tfd);
+	if (efd >= 0)
+		close(efd);
+}
+
+int fileupdate_watch_set::add(const std::string &fullpath)
+{
+	boost::filesystem::path p(fullpath);
+	struct watched_file file;
+
+	if (efd < 0)
+		return -EBADF;
+
+	file.path = fullpath;
+	file.filename = p.filename().string();
+	file.wd = -EINVAL;
+	file.offset = 0;
+	file.advanced = false;
+	file.sized = false;
+
+	if (fd >= 0 && inotify_visible(fullpath)) {
+		// bare file name refers to the working directory
+		std::string dir = p.has_parent_path() ? p.parent_path().string() : ".";
+
+		// watches of the same directory are shared
+		file.wd = inotify_add_watch(fd, dir.c_str(), IN_MODIFY);
+		if (file.wd < 0)
+			std::cerr << "inotify_add_watch failed: " << errno << std::endl;
+	}
+
+	// polling sees every file, only slower
+	if (file.wd < 0 && tfd < 0)
+		return -EBADF;
+
+	files.push_back(file);
+	return (int)files.size() - 1;
+}
+
+void fileupdate_watch_set::drained(size_t index, uint64_t offset)
+{
+	struct watched_file &file = files[index];
+
+	file.advanced = offset != file.offset;
+	file.offset = offset;
+}
+
+int fileupdate_watch_set::arm_timer()
+{
+	struct itimerspec its = {};
+
+	its.it_value.tv_sec = interval / 1000;
+	its.it_value.tv_nsec = (interval % 1000) * 1000000;
+	if (timerfd_settime(tfd, 0, &its, NULL) < 0) {
+		std::cerr << "timerfd_settime failed: " << errno << std::endl;
+		return errno;
+	}
+	return 0;
+}
+
+int fileupdate_watch_set::read_events(std::vector<bool> &found)
+{
+	std::unique_ptr<char[]> bufptr(new char[BUF_LEN]);
+	char *buf = bufptr.get();
+	ssize_t len, n = 0;
+
+	len = read(fd, buf, BUF_LEN);
+	if (len < 0) {
+		std::cerr << "inotify read failed: " << errno << std::endl;
+		return errno;
+	}
+
+	while (n < len) {
+		struct inotify_event *event = (struct inotify_event *)&buf[n];
+
+		for (size_t i = 0; i < files.size(); i++)
+			if (files[i].wd == event->wd && event->len &&
+			    !files[i].filename.compare(event->name))
+				found[i] = true;
+		n += sizeof(*event) + event->len;
+	}
+
+	return 0;
+}
+
+int fileupdate_watch_set::wait(std::vector<size_t> &ready)
+{
+	std::vector<bool> found(files.size(), false);
+	bool polled = false, advanced = false, blind = false;
+	struct pollfd fds[3];
+	int ret;
+
+	for (auto it = files.begin(); it != files.end(); it++) {
+		if (it->wd >= 0)
+			continue;
+		polled = true;
+		advanced |= it->advanced;
+		blind |= !it->sized;
+		it->advanced = false;
+	}
+
+	// previous tick brought nothing, no point in retrying at the same pace
+	if (advanced)
+		interval = AVS_POLL_MIN_INTERVAL;
+	else if (blind)
+		interval = std::min<uint64_t>(interval * 2, AVS_POLL_MAX_INTERVAL);
+
+	fds[0] = { efd, POLLIN, 0 };
+	fds[1] = { fd, POLLIN, 0 }; // negative fds are ignored
+	fds[2] = { polled ? tfd : -1, POLLIN, 0 };
+
+	if (polled) {
+		ret = arm_timer();
+		if (ret)
+			return ret;
+	}
+
+	ready.clear();
+	while (ready.empty()) {
+		ret = poll(fds, 3, -1);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			std::cerr << "poll failed: " << errno << std::endl;
+			return errno;
+		}
+
+		if (fds[0].revents) {
+			uint64_t count;
+
+			if (read(efd, &count, sizeof(count)) < 0)
+				std::cerr << "eventfd read failed: " << errno << std::endl;
+			return EINTR;
+		}
+
+		if (fds[1].revents) {
+			ret = read_events(found);
+			if (ret)
+				return ret;
+		}
+
+		if (fds[2].revents) {
+			uint64_t expirations;
+			bool changed = false;
+
+			if (read(tfd, &expirations, sizeof(expirations)) < 0)
+				std::cerr << "timerfd read failed: " << errno << std::endl;
+
+			for (size_t i = 0; i < files.size(); i++) {
+				if (files[i].wd >= 0)
+					continue;
+				if (poll_file_changed(files[i].path, files[i].offset,
+						      files[i].sized)) {
+					found[i] = true;
+					changed = true;
+				}
+			}
+
+			if (!changed)
+				interval = std::min<uint64_t>(interval * 2, AVS_POLL_MAX_INTERVAL);
+			ret = arm_timer();
+			if (ret)
+				return ret;
+		}
+
+		for (size_t i = 0; i < found.size(); i++)
+			if (found[i])
+				ready.push_back(i);
+	}
+
+	return 0;
+}
+
+void fileupdate_watch_set::interrupt()
+{
+	uint64_t count = 1;
+
+	if (write(efd, &count, sizeof(count)) < 0)
+		std::cerr << "eventfd write failed: " << errno << std::endl;
+}
+
+#endif
@@ -0,0 +1,22 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <iostream>
+#include "flush_controller.hpp"
+
+void flush_controller::report(std::ostream &out) const
+{
+	uint64_t total = idle_flushes + latency_flushes + batch_flushes + forced_flushes;
+
+	out << "flushed " << flushed << " bytes in " << total << " flushes: "
+	    << idle_flushes << " when idle, " << latency_flushes << " on latency, "
+	    << batch_flushes << " on batch size, " << forced_flushes << " forced";
+	if (total)
+		out << ", " << flushed / total << " bytes on average";
+	out << std::endl;
+}
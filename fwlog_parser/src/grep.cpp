@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <cctype>
+#include <cstring>
+#include <string>
+#include "grep.hpp"
+
+// Returns position right past the class or group starting at @pos.
+static size_t skip_nested(const std::string &p, size_t pos)
+{
+	int depth = 0;
+	bool in_class = false;
+
+	for (; pos < p.size(); pos++) {
+		char c = p[pos];
+
+		if (c == '\\') {
+			pos++;
+		} else if (in_class) {
+			in_class = c != ']';
+		} else if (c == '[') {
+			in_class = true;
+			// ']' right after the opening one, if any, is a member
+			if (pos + 1 < p.size() && p[pos + 1] == '^')
+				pos++;
+			if (pos + 1 < p.size() && p[pos + 1] == ']')
+				pos++;
+		} else if (c == '(') {
+			depth++;
+		} else if (c == ')') {
+			depth--;
+		}
+
+		if (!depth && !in_class)
+			return pos + 1;
+	}
+
+	return pos;
+}
+
+static void take_longer(std::string &best, std::string &run)
+{
+	if (run.size() > best.size())
+		best = run;
+	run.clear();
+}
+
+std::string required_literal(const std::string &p)
+{
+	std::string best, run;
+	size_t i = 0;
+
+	/*
+	 * Only plain characters outside of groups and classes are considered,
+	 * anything else breaks the run. Alternation at this level means no
+	 * part is required at all.
+	 */
+	while (i < p.size()) {
+		char c = p[i];
+
+		if (c == '\\' && i + 1 < p.size()) {
+			char e = p[i + 1];
+
+			i += 2;
+			if (!isalnum((unsigned char)e)) {
+				run.push_back(e);
+				continue;
+			}
+
+			take_longer(best, run);
+			// skip operands of the escape, if any
+			if (e == 'x')
+				i += 2;
+			else if (e == 'u')
+				i += 4;
+			else if (e == 'c')
+				i += 1;
+			else if (isdigit((unsigned char)e))
+				while (i < p.size() && isdigit((unsigned char)p[i]))
+					i++;
+			continue;
+		}
+
+		switch (c) {
+		case '|':
+			return std::string();
+
+		case '(':
+		case '[':
+			take_longer(best, run);
+			i = skip_nested(p, i);
+			continue;
+
+		case '*':
+		case '?':
+			// preceding character is optional
+			if (!run.empty())
+				run.pop_back();
+			take_longer(best, run);
+			break;
+
+		case '{':
+			if (i + 1 < p.size() && p[i + 1] == '0' && !run.empty())
+				run.pop_back();
+			take_longer(best, run);
+			while (i < p.size() && p[i] != '}')
+				i++;
+			break;
+
+		case '+':
+		case '.':
+		case '^':
+		case '$':
+			take_longer(best, run);
+			break;
+
+		default:
+			run.push_back(c);
+			break;
+		}
+
+		i++;
+	}
+
+	take_longer(best, run);
+	return best;
+}
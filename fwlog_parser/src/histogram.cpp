@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "histogram.hpp"
+
+#define SUB_BITS	4 // log2 of AVS_HISTOGRAM_SUB_BUCKETS
+#define BAR_WIDTH	40
+
+static_assert(AVS_HISTOGRAM_SUB_BUCKETS == 1 << SUB_BITS, "SUB_BITS mismatch");
+
+static unsigned int ilog2(uint64_t v)
+{
+	unsigned int r = 0;
+
+	for (unsigned int shift = 32; shift; shift >>= 1) {
+		if (v >> shift) {
+			v >>= shift;
+			r += shift;
+		}
+	}
+	return r;
+}
+
+histogram::histogram()
+	: buckets(bucket(UINT64_MAX) + 1), total(0), lowest(UINT64_MAX), highest(0), sum(0)
+{
+}
+
+size_t histogram::bucket(uint64_t value)
+{
+	unsigned int e;
+
+	// values below the sub-bucket count are kept exact
+	if (value < AVS_HISTOGRAM_SUB_BUCKETS)
+		return (size_t)value;
+
+	e = ilog2(value) - SUB_BITS;
+	return AVS_HISTOGRAM_SUB_BUCKETS * (e + 1) + (size_t)(value >> e) -
+	       AVS_HISTOGRAM_SUB_BUCKETS;
+}
+
+uint64_t histogram::upper_bound(size_t b)
+{
+	size_t e, sub;
+
+	if (b < AVS_HISTOGRAM_SUB_BUCKETS)
+		return b + 1;
+
+	e = b / AVS_HISTOGRAM_SUB_BUCKETS - 1;
+	sub = b % AVS_HISTOGRAM_SUB_BUCKETS;
+	// top of the last bucket does not fit in 64 bits
+	if (e + SUB_BITS + 1 >= 64 && sub == AVS_HISTOGRAM_SUB_BUCKETS - 1)
+		return UINT64_MAX;
+	return (uint64_t)(AVS_HISTOGRAM_SUB_BUCKETS + sub + 1) << e;
+}
+
+void histogram::add(uint64_t value)
+{
+	buckets[bucket(value)]++;
+	total++;
+	sum += (double)value;
+	if (value < lowest)
+		lowest = value;
+	if (value > highest)
+		highest = value;
+}
+
+uint64_t histogram::percentile(double p) const
+{
+	uint64_t target = (uint64_t)std::ceil(p / 100 * total);
+	uint64_t seen = 0;
+
+	if (!target)
+		target = 1;
+
+	for (size_t b = 0; b < buckets.size(); b++) {
+		seen += buckets[b];
+		if (seen >= target) {
+			uint64_t top = upper_bound(b) - 1;
+
+			return top < highest ? top : highest;
+		}
+	}
+
+	return highest;
+}
+
+void histogram::print(std::ostream &out) const
+{
+	std::vector<uint64_t> ranges(65, 0);
+	uint64_t peak = 0;
+	char buf[128];
+
+	if (!total) {
+		out << "  no samples\n";
+		return;
+	}
+
+	snprintf(buf, sizeof(buf), "  count %llu, min %llu, mean %.1f, max %llu\n",
+		 (unsigned long long)total, (unsigned long long)lowest, mean(),
+		 (unsigned long long)highest);
+	out << buf;
+	snprintf(buf, sizeof(buf), "  p50 %llu, p90 %llu, p99 %llu, p99.9 %llu\n",
+		 (unsigned long long)percentile(50), (unsigned long long)percentile(90),
+		 (unsigned long long)percentile(99), (unsigned long long)percentile(99.9));
+	out << buf;
+
+	// range r holds values of [2^(r-1), 2^r), range 0 holds zeros
+	for (size_t b = 0; b < buckets.size(); b++) {
+		uint64_t lower = b ? upper_bound(b - 1) : 0;
+		size_t r = lower ? ilog2(lower) + 1 : 0;
+
+		ranges[r] += buckets[b];
+		if (ranges[r] > peak)
+			peak = ranges[r];
+	}
+
+	for (size_t r = 0; r < ranges.size(); r++) {
+		if (!ranges[r])
+			continue;
+
+		uint64_t lower = r ? 1ULL << (r - 1) : 0;
+		size_t width = (size_t)((ranges[r] * BAR_WIDTH + peak - 1) / peak);
+
+		snprintf(buf, sizeof(buf), "  %20llu.. %12llu ",
+			 (unsigned long long)lower, (unsigned long long)ranges[r]);
+		out << buf << std::string(width, '#') << "\n";
+	}
+}
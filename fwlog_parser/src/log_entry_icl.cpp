@@ -12,12 +12,14 @@
 #include "elf.h"
 #endif
 
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <map>
 #include <string>
 #include <vector>
 #include "log_entry_icl.hpp"
+#include "text_template.hpp"
 
 static int elf_find_section(std::vector<Elf32_Shdr> &sections,
 			    const std::string &strings, const char *name)
@@ -63,57 +65,63 @@ static void elf_read_symbols(std::istream &elf, Elf32_Shdr *symsection,
 }
 
 static void elf_init_literal(std::istream &elf, struct log_literal2_0 &literal,
+			     string_arena &strings, std::vector<char> &scratch,
 			     Elf32_Sym *sym, Elf32_Shdr *shdr, Elf32_Shdr *funcstrs)
 {
 	elf.seekg(shdr->off + (sym->value - shdr->vaddr));
 	elf.read((char *)&literal.hdr, sizeof(literal.hdr));
 
-	literal.text.resize(literal.hdr.text_len);
-	elf.read(const_cast<char *>(literal.text.data()), literal.hdr.text_len);
+	scratch.resize(literal.hdr.text_len);
+	elf.read(scratch.data(), literal.hdr.text_len);
+	literal.text = strings.intern(scratch.data(), (size_t)elf.gcount());
 
 	if (literal.hdr.file >= funcstrs->vaddr &&
 	    literal.hdr.file <= (funcstrs->vaddr + funcstrs->size)) {
 		uint64_t offset = literal.hdr.file - funcstrs->vaddr;
 
-		literal.filename.resize(FILENAME_MAX);
+		scratch.resize(FILENAME_MAX);
 		elf.seekg(funcstrs->off + offset, std::ios_base::beg);
-		elf.read(const_cast<char *>(literal.filename.data()), FILENAME_MAX);
+		elf.read(scratch.data(), FILENAME_MAX);
+		literal.filename = strings.intern(scratch.data(), (size_t)elf.gcount());
+		// filename may be close to the end of file
+		elf.clear();
 	} else {
-		literal.filename.assign("invalid_filename");
+		literal.filename = strings.intern("invalid_filename");
 	}
 
 	literal.key.entry_id = sym->value >> 7;
 }
 
 void build_provider(std::map<uint64_t, struct log_literal2_0> &provider,
-		    const std::string &inpath)
+		    string_arena &strings, const std::string &inpath)
 {
 	std::ifstream elf(inpath, std::fstream::binary);
 
 	std::vector<Elf32_Shdr> sections;
 	std::vector<Elf32_Sym> symbols;
+	std::vector<char> scratch;
 	Elf32_Shdr funcstrs;
 	Elf32_Ehdr ehdr;
-	std::string strings;
+	std::string shstrings;
 
 	elf_read_header(elf, &ehdr);
 	elf_read_sections(elf, &ehdr, sections);
-	elf_read_strings(elf, &sections[ehdr.shstrndx], strings);
+	elf_read_strings(elf, &sections[ehdr.shstrndx], shstrings);
 
-	int idx = elf_find_section(sections, strings, ".symtab");
+	int idx = elf_find_section(sections, shstrings, ".symtab");
 	if (idx == -1)
 		throw std::invalid_argument("No symtab");
 
 	elf_read_symbols(elf, &sections[idx], symbols);
 
-	idx = elf_find_section(sections, strings, ".function_strings");
+	idx = elf_find_section(sections, shstrings, ".function_strings");
 	if (idx == -1)
 		throw std::invalid_argument("No functions_strings");
 
 	funcstrs = sections[idx];
 
 	for (auto it = symbols.begin(); it != symbols.end(); it++) {
-		struct log_literal2_0 literal = {0};
+		struct log_literal2_0 literal = {};
 		Elf32_Shdr *shdr;
 
 		if (it->shndx >= ehdr.shnum)
@@ -121,37 +129,80 @@ void build_provider(std::map<uint64_t, struct log_literal2_0> &provider,
 		shdr = &sections[it->shndx];
 		// use strstr() instead of string::find() as it honors '\0'
 		// which separate each entry
-		if (!strstr(strings.data() + shdr->name, "log_entries"))
+		if (!strstr(shstrings.data() + shdr->name, "log_entries"))
 			continue;
 
-		elf_init_literal(elf, literal, &*it, shdr, &funcstrs);
+		elf_init_literal(elf, literal, strings, scratch, &*it, shdr, &funcstrs);
 		provider.insert({literal.key.entry_id, literal});
 	}
 }
 
-int write_entry(std::ostream &out, struct log_literal2_0 *literal,
+void relocate_strings(struct log_literal2_0 &literal, uint32_t base)
+{
+	literal.text += base;
+	literal.filename += base;
+}
+
+int write_entry(std::ostream &out, const string_arena &strings,
+		const struct log_literal2_0 *literal,
 		const log_entry_icl &entry, uint32_t *data)
 {
-	std::string format;
 	char buf[512];
-	int ret;
+	int ret, len;
 
 	ret = snprintf(buf, sizeof(buf), "%llu: %s(%u):\n",
 		       (unsigned long long)entry.data->timestamp,
-		       literal->filename.data(), literal->hdr.line);
+		       strings.c_str(literal->filename), literal->hdr.line);
 	if (ret < 0)
 		return ret;
 	out << buf;
 
-	format = "%lld: " + literal->text;
+	len = snprintf(buf, sizeof(buf), "%lld: ", (long long)entry.data->timestamp);
+	if (len < 0)
+		return len;
 
-	ret = snprintf(buf, sizeof(buf), format.data(),
-		       entry.data->timestamp,
+	ret = snprintf(buf + len, sizeof(buf) - len, strings.c_str(literal->text),
 		       data[0], data[1], data[2], data[3],
 		       data[4], data[5], data[6]);
 	if (ret < 0)
 		return ret;
-	out << buf << std::endl;
+	out << buf << "\n";
 
 	return 0;
 }
+
+void write_template(std::string &tmpl, const string_arena &strings,
+		    const struct log_literal2_0 *literal)
+{
+	const char N = AVS_TEMPLATE_NUMBER;
+
+	// mirrors write_entry(), only the timestamp varies besides the text
+	tmpl += { N, ':', ' ' };
+	tmpl += strings.c_str(literal->filename);
+	tmpl += "(" + std::to_string(literal->hdr.line) + "):\n";
+	tmpl += { N, ':', ' ' };
+	printf_template(tmpl, strings.c_str(literal->text));
+	tmpl += '\n';
+}
+
+void write_site(std::string &site, const string_arena &strings,
+		const struct log_literal2_0 *literal)
+{
+	site += strings.c_str(literal->filename);
+	site += "(" + std::to_string(literal->hdr.line) + "): ";
+	site += strings.c_str(literal->text);
+}
+
+void write_level(std::string &level, const string_arena &strings,
+		 const struct log_literal2_0 *literal)
+{
+	level += std::to_string(literal->hdr.level);
+}
+
+bool log_entry_icl::parse_key(const std::string &str, uint64_t &key)
+{
+	char *end;
+
+	key = strtoull(str.c_str(), &end, 0);
+	return !str.empty() && !*end;
+}
@@ -7,17 +7,20 @@
  */
 
 #include <algorithm>
+#include <cstdlib>
 #include <boost/algorithm/string.hpp>
 #include <fstream>
 #include <map>
 #include <string>
 #include <vector>
 #include "log_entry_spt.hpp"
+#include "text_template.hpp"
 
 // Number of fields for struct log_literal1_5
 #define LOG_LITERAL_TOKEN_COUNT 10
 
-static void init_literal(struct log_literal1_5 &literal, const std::string &record)
+static void init_literal(struct log_literal1_5 &literal, string_arena &strings,
+			 const std::string &record)
 {
 	std::vector<std::string> tokens;
 
@@ -52,57 +55,72 @@ static void init_literal(struct log_literal1_5 &literal, const std::string &reco
 
 	literal.key.file_id = atoi(tokens[0].c_str());
 	literal.key.line_num = atoi(tokens[1].c_str());
-	literal.filename = tokens[2];
-	literal.provider = tokens[3];
-	literal.loglevel = tokens[4];
-	literal.message = tokens[5] + "\n";
-	literal.param1 = tokens[6];
-	literal.param2 = tokens[7];
-	literal.param3 = tokens[8];
-	literal.param4 = tokens[9];
+	literal.filename = strings.intern(tokens[2]);
+	literal.provider = strings.intern(tokens[3]);
+	literal.loglevel = strings.intern(tokens[4]);
+	literal.message = strings.intern(tokens[5] + "\n");
+	literal.param1 = strings.intern(tokens[6]);
+	literal.param2 = strings.intern(tokens[7]);
+	literal.param3 = strings.intern(tokens[8]);
+	literal.param4 = strings.intern(tokens[9]);
 }
 
 void build_provider(std::map<uint64_t, struct log_literal1_5> &provider,
-		    const std::string &inpath)
+		    string_arena &strings, const std::string &inpath)
 {
 	std::ifstream csv(inpath);
 	std::string line;
 
 	while (std::getline(csv, line)) {
-		struct log_literal1_5 literal = {0};
+		struct log_literal1_5 literal = {};
 
-		init_literal(literal, line);
+		init_literal(literal, strings, line);
 		provider.emplace(literal.key.entry_id, literal);
 	}
 }
 
-int write_entry(std::ostream &out, struct log_literal1_5 *literal,
+void relocate_strings(struct log_literal1_5 &literal, uint32_t base)
+{
+	literal.filename += base;
+	literal.provider += base;
+	literal.loglevel += base;
+	literal.message += base;
+	literal.param1 += base;
+	literal.param2 += base;
+	literal.param3 += base;
+	literal.param4 += base;
+}
+
+int write_entry(std::ostream &out, const string_arena &strings,
+		const struct log_literal1_5 *literal,
 		const log_entry_spt &entry, uint32_t *data)
 {
 	static char buf[512];
+	const char *message = strings.c_str(literal->message);
 	int ret;
 
 	ret = snprintf(buf, sizeof(buf), "%llu: %u %u,%u %s(%u): %s ",
 		       (unsigned long long)entry.data->timestamp, entry.data->core_id,
-		       entry.data->module.type, entry.data->instance_id, literal->filename.c_str(),
-		       literal->key.line_num, literal->loglevel.c_str());
+		       entry.data->module.type, entry.data->instance_id,
+		       strings.c_str(literal->filename), literal->key.line_num,
+		       strings.c_str(literal->loglevel));
 	if (ret < 0)
 		return ret;
 
 	switch (entry.data->entry_length) {
 	case 0:
-		ret = snprintf(buf + ret, sizeof(buf) - ret, literal->message.c_str(), data[0]);
+		ret = snprintf(buf + ret, sizeof(buf) - ret, message, data[0]);
 		break;
 	case 1:
-		ret = snprintf(buf + ret, sizeof(buf) - ret, literal->message.c_str(), data[0],
+		ret = snprintf(buf + ret, sizeof(buf) - ret, message, data[0],
 			       data[1]);
 		break;
 	case 2:
-		ret = snprintf(buf + ret, sizeof(buf) - ret, literal->message.c_str(), data[0],
+		ret = snprintf(buf + ret, sizeof(buf) - ret, message, data[0],
 			       data[1], data[2]);
 		break;
 	case 3:
-		ret = snprintf(buf + ret, sizeof(buf) - ret, literal->message.c_str(), data[0],
+		ret = snprintf(buf + ret, sizeof(buf) - ret, message, data[0],
 			       data[1], data[2], data[3]);
 		break;
 	default:
@@ -115,3 +133,52 @@ int write_entry(std::ostream &out, struct log_literal1_5 *literal,
 
 	return 0;
 }
+
+void write_template(std::string &tmpl, const string_arena &strings,
+		    const struct log_literal1_5 *literal)
+{
+	const char N = AVS_TEMPLATE_NUMBER;
+
+	// mirrors write_entry(), timestamp, core, module type and instance vary
+	tmpl += { N, ':', ' ', N, ' ', N, ',', N, ' ' };
+	tmpl += strings.c_str(literal->filename);
+	tmpl += "(" + std::to_string(literal->key.line_num) + "): ";
+	tmpl += strings.c_str(literal->loglevel);
+	tmpl += ' ';
+	printf_template(tmpl, strings.c_str(literal->message));
+}
+
+void write_site(std::string &site, const string_arena &strings,
+		const struct log_literal1_5 *literal)
+{
+	site += strings.c_str(literal->filename);
+	site += "(" + std::to_string(literal->key.line_num) + "): ";
+	site += strings.c_str(literal->loglevel);
+	site += ' ';
+	site += strings.c_str(literal->message);
+}
+
+void write_level(std::string &level, const string_arena &strings,
+		 const struct log_literal1_5 *literal)
+{
+	level += strings.c_str(literal->loglevel);
+}
+
+bool log_entry_spt::parse_key(const std::string &str, uint64_t &key)
+{
+	union entry_key k;
+	unsigned long file_id, line_num;
+	char *end;
+
+	file_id = strtoul(str.c_str(), &end, 0);
+	if (*end != ':')
+		return false;
+	line_num = strtoul(end + 1, &end, 0);
+	if (*end)
+		return false;
+
+	k.file_id = file_id;
+	k.line_num = line_num;
+	key = k.entry_id;
+	return true;
+}
@@ -0,0 +1,339 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "log_server.hpp"
+
+#if defined(AVS_HAVE_LOG_SERVER)
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+log_server::log_server(const std::string &p)
+	: path(p), listen_fd(-1), efd(-1), done(false)
+{
+	struct sockaddr_un addr = {};
+
+	if (path.size() >= sizeof(addr.sun_path))
+		throw std::invalid_argument("Socket path too long: " + path);
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path.c_str());
+
+	listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (listen_fd < 0)
+		throw std::runtime_error("Failed to create socket");
+
+	// socket may be left over by previous instance
+	unlink(path.c_str());
+	if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+	    listen(listen_fd, SOMAXCONN)) {
+		close(listen_fd);
+		throw std::runtime_error("Failed to listen on " + path);
+	}
+
+	efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (efd < 0) {
+		close(listen_fd);
+		unlink(path.c_str());
+		throw std::runtime_error("Failed to create eventfd");
+	}
+
+	worker = std::thread(&log_server::run, this);
+}
+
+log_server::~log_server()
+{
+	done = true;
+	wake();
+	worker.join();
+
+	for (auto it = subs.begin(); it != subs.end(); it++)
+		close((*it)->fd);
+	close(efd);
+	close(listen_fd);
+	unlink(path.c_str());
+}
+
+void log_server::wake()
+{
+	uint64_t val = 1;
+
+	if (write(efd, &val, sizeof(val)) < 0 && errno != EAGAIN)
+		std::cerr << "eventfd write failed: " << errno << std::endl;
+}
+
+void log_server::queue(struct subscriber &s, const struct text_chunk &chunk,
+		       const struct record_ref &r)
+{
+	const char *data;
+	size_t size;
+
+	if (s.lib_id >= 0 && (!r.raw_len || r.lib_id != (uint32_t)s.lib_id))
+		return;
+	if (!s.match.empty()) {
+		const char *begin = chunk.text.data() + r.text;
+		const char *end = begin + r.text_len;
+
+		if (std::search(begin, end, s.match.begin(), s.match.end()) == end)
+			return;
+	}
+
+	if (s.binary) {
+		data = chunk.raw.data() + r.raw;
+		size = r.raw_len;
+	} else {
+		data = chunk.text.data() + r.text;
+		size = r.text_len;
+	}
+	if (!size)
+		return;
+
+	if (s.pending.size() - s.sent + size > AVS_SERVER_BACKLOG) {
+		if (s.detach) {
+			s.closing = true;
+			s.overrun = true;
+			return;
+		}
+		s.dropped++;
+		s.lost++;
+		return;
+	}
+
+	// binary stream has to remain decodable, no notice there
+	if (s.dropped && !s.binary) {
+		char buf[64];
+
+		snprintf(buf, sizeof(buf), "Dropped %llu records\n",
+			 (unsigned long long)s.dropped);
+		s.pending.append(buf);
+	}
+	s.dropped = 0;
+	s.pending.append(data, size);
+}
+
+void log_server::publish(const struct text_chunk &chunk)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	bool queued = false;
+
+	for (auto it = subs.begin(); it != subs.end(); it++) {
+		struct subscriber &s = **it;
+
+		if (!s.ready || s.closing)
+			continue;
+
+		size_t before = s.pending.size();
+
+		for (size_t i = 0; i < chunk.records.size() && !s.closing; i++)
+			queue(s, chunk, chunk.records[i]);
+		queued |= s.pending.size() != before || s.closing;
+	}
+
+	if (queued)
+		wake();
+}
+
+void log_server::accept_subscriber()
+{
+	int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+	if (fd < 0) {
+		if (errno != EAGAIN)
+			std::cerr << "accept failed: " << errno << std::endl;
+		return;
+	}
+
+	subs.emplace_back(new subscriber(fd));
+}
+
+static int parse_request(const std::string &line, long &lib_id, bool &binary, bool &detach,
+			 std::string &match)
+{
+	std::istringstream iss(line);
+	std::string tok;
+
+	while (iss >> tok) {
+		if (tok == "text") {
+			binary = false;
+		} else if (tok == "binary") {
+			binary = true;
+		} else if (tok == "drop") {
+			detach = false;
+		} else if (tok == "detach") {
+			detach = true;
+		} else if (!tok.compare(0, 4, "lib=")) {
+			char *end;
+
+			lib_id = strtol(tok.c_str() + 4, &end, 0);
+			if (*end || end == tok.c_str() + 4 || lib_id < 0)
+				return -EINVAL;
+		} else if (!tok.compare(0, 6, "match=")) {
+			std::string rest;
+
+			std::getline(iss, rest);
+			match = tok.substr(6) + rest;
+			break;
+		} else {
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+void log_server::read_request(struct subscriber &s)
+{
+	char buf[512];
+	ssize_t ret;
+
+	ret = read(s.fd, buf, sizeof(buf));
+	if (ret < 0) {
+		if (errno != EAGAIN && errno != EINTR)
+			s.closing = true;
+		return;
+	}
+	if (!ret) {
+		s.closing = true;
+		return;
+	}
+	// anything sent past the request is ignored
+	if (s.ready)
+		return;
+
+	s.request.append(buf, ret);
+	size_t eol = s.request.find('\n');
+	if (eol == std::string::npos) {
+		if (s.request.size() > AVS_SERVER_REQUEST_MAX)
+			s.closing = true;
+		return;
+	}
+
+	s.request.resize(eol);
+	if (!s.request.empty() && s.request.back() == '\r')
+		s.request.pop_back();
+
+	if (parse_request(s.request, s.lib_id, s.binary, s.detach, s.match)) {
+		static const char reply[] = "Invalid request\n";
+
+		// best effort, subscriber is going away anyway
+		if (send(s.fd, reply, sizeof(reply) - 1, MSG_NOSIGNAL) < 0)
+			std::cerr << "send failed: " << errno << std::endl;
+		s.closing = true;
+		return;
+	}
+
+	s.ready = true;
+}
+
+void log_server::flush(struct subscriber &s)
+{
+	while (s.sent < s.pending.size()) {
+		ssize_t ret = send(s.fd, s.pending.data() + s.sent, s.pending.size() - s.sent,
+				   MSG_NOSIGNAL | MSG_DONTWAIT);
+
+		if (ret < 0) {
+			if (errno != EAGAIN && errno != EINTR)
+				s.closing = true;
+			break;
+		}
+		s.sent += ret;
+	}
+
+	if (s.sent == s.pending.size()) {
+		s.pending.clear();
+		s.sent = 0;
+	} else if (s.sent > s.pending.size() / 2) {
+		s.pending.erase(0, s.sent);
+		s.sent = 0;
+	}
+}
+
+void log_server::run()
+{
+	std::vector<struct pollfd> fds;
+
+	while (!done) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			fds.resize(2 + subs.size());
+			fds[0] = { efd, POLLIN, 0 };
+			fds[1] = { listen_fd, POLLIN, 0 };
+			for (size_t i = 0; i < subs.size(); i++) {
+				short events = POLLIN;
+
+				if (subs[i]->sent < subs[i]->pending.size())
+					events |= POLLOUT;
+				fds[2 + i] = { subs[i]->fd, events, 0 };
+			}
+		}
+
+		if (poll(fds.data(), fds.size(), -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			std::cerr << "poll failed: " << errno << std::endl;
+			break;
+		}
+
+		if (fds[0].revents & POLLIN) {
+			uint64_t val;
+
+			if (read(efd, &val, sizeof(val)) < 0 && errno != EAGAIN)
+				std::cerr << "eventfd read failed: " << errno << std::endl;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		// only this thread adds or removes subscribers, indexes are stable
+		for (size_t i = 0; i + 2 < fds.size(); i++) {
+			struct subscriber &s = *subs[i];
+			short revents = fds[2 + i].revents;
+
+			if (revents & POLLIN)
+				read_request(s);
+			if (revents & (POLLERR | POLLHUP))
+				s.closing = true;
+			if (!s.closing)
+				flush(s);
+		}
+
+		// including those detached by publish()
+		for (auto it = subs.begin(); it != subs.end();) {
+			struct subscriber &s = **it;
+
+			if (!s.closing) {
+				it++;
+				continue;
+			}
+			if (s.lost)
+				std::cerr << "subscriber lost " << s.lost << " records"
+					  << std::endl;
+			if (s.overrun)
+				std::cerr << "subscriber detached, too far behind" << std::endl;
+			close(s.fd);
+			it = subs.erase(it);
+		}
+
+		if (fds[1].revents & POLLIN)
+			accept_subscriber();
+	}
+}
+
+#endif // AVS_HAVE_LOG_SERVER
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <iostream>
+#include "loss_detector.hpp"
+
+loss_detector::loss_detector(uint64_t start, uint64_t gap)
+	: max_gap(gap), expected(start), skipped_bytes(0), bursts(0), regressions(0), gaps(0),
+	  largest_gap(0)
+{
+}
+
+void loss_detector::skipped(std::ostream &out, uint64_t pos)
+{
+	// position may go back only if the producer restarted
+	if (pos > expected) {
+		out << "Skipped " << (unsigned long long)(pos - expected)
+		    << " bytes at position: " << (unsigned long long)expected << "\n";
+		skipped_bytes += pos - expected;
+	} else {
+		out << "Position went back to: " << (unsigned long long)pos << "\n";
+	}
+	bursts++;
+}
+
+void loss_detector::regressed(std::ostream &out, uint64_t pos, uint32_t core, uint64_t delta)
+{
+	out << "Timestamp went back by " << (unsigned long long)delta << " on core " << core
+	    << " at position: " << (unsigned long long)pos << "\n";
+	regressions++;
+}
+
+void loss_detector::gap(std::ostream &out, uint64_t pos, uint32_t core, uint64_t delta)
+{
+	out << "Timestamp gap of " << (unsigned long long)delta << " on core " << core
+	    << " at position: " << (unsigned long long)pos << "\n";
+	gaps++;
+	if (delta > largest_gap)
+		largest_gap = delta;
+}
+
+void loss_detector::report(std::ostream &out, uint64_t end) const
+{
+	uint64_t trailing = end > expected ? end - expected : 0;
+
+	out << "loss summary: " << skipped_bytes + trailing << " bytes skipped in "
+	    << bursts + (trailing ? 1 : 0) << " bursts";
+	if (trailing)
+		out << " (" << trailing << " bytes at the end)";
+	out << ", " << regressions << " timestamp regressions";
+	if (max_gap)
+		out << ", " << gaps << " gaps over " << max_gap << " (largest " << largest_gap
+		    << ")";
+	out << std::endl;
+}
@@ -6,35 +6,43 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <boost/filesystem/operations.hpp>
 #include <boost/program_options.hpp>
+#include <cerrno>
 #include <iostream>
 #include <fstream>
+#include <limits>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <regex>
 #include <string>
 #include <vector>
+#include "checkpoint.hpp"
+#include "circular_dump.hpp"
+#include "demux.hpp"
+#include "extract.hpp"
+#include "dictionary.hpp"
 #include "fileupdate_listener.hpp"
+#include "flight_recorder.hpp"
+#include "grep.hpp"
+#include "log_server.hpp"
+#include "logdump.hpp"
+#include "multi_follow.hpp"
+#include "pipeline.hpp"
+#include "profile.hpp"
+#include "sample.hpp"
+#include "shm_ring.hpp"
+#include "signal_waiter.hpp"
+#include "span.hpp"
+#include "trace_index.hpp"
+#include "trace_reader.hpp"
+#include "trace_reader_stream.hpp"
 #include "log_entry_spt.hpp"
 #include "log_entry_icl.hpp"
 
 using namespace boost::program_options;
 
-class detailed_path {
-public:
-	detailed_path(const std::string &p, int id)
-		: path(p), lib_id(id)
-	{
-	}
-
-	detailed_path()
-		: detailed_path("", 0)
-	{
-	}
-
-	std::string path;
-	int lib_id;
-};
-
 static void validate(boost::any& v,
 		     const std::vector<std::string>& values,
 		     detailed_path*, int)
@@ -54,112 +62,564 @@ static void validate(boost::any& v,
 	v = boost::any(detailed_path(match[1], boost::lexical_cast<int>(match[2])));
 }
 
-static void conflicting_options(const variables_map& vm,
-				const char* opt1, const char* opt2)
+// Frames the sample as if it was made of EntryT records and returns
+// the number of bytes covered by records known to the dictionary
+template <class EntryT>
+size_t score_logdump(std::string &sample, dictionary<typename EntryT::literal_type> &dict)
 {
-	if (vm.count(opt1) && !vm[opt1].defaulted() &&
-	    vm.count(opt2) && !vm[opt2].defaulted())
-		throw std::logic_error(std::string("Conflicting options '") +
-			               opt1 + "' and '" + opt2 + "'.");
+	EntryT entry;
+	size_t pos = 0, score = 0;
+
+	while (pos + entry.hdr_size() <= sample.size()) {
+		char *buf = &sample[pos];
+		size_t size = entry.size(*buf);
+
+		if (pos + size > sample.size())
+			break;
+
+		entry.assign_ptr(buf);
+		if (entry.is_valid() && dict.find(entry.lib_id(), entry.key())) {
+			score += size;
+			pos += size;
+			continue;
+		}
+
+		pos += sizeof(uint32_t);
+	}
+
+	return score;
 }
 
-template <typename LiteralT, class EntryT>
-void process_logdump(std::istream &in, std::ostream &out,
-		     std::map<int, std::map<uint64_t, LiteralT>> &dict)
+// amount of data sampled from the beginning of the trace, in bytes
+#define AVS_DETECT_SAMPLE_SIZE (64 * 1024)
+
+static std::string detect_format(const std::string &inpath,
+				 dictionary<struct log_literal1_5> &spt,
+				 dictionary<struct log_literal2_0> &icl)
 {
-	static_assert(std::is_convertible<EntryT *, ilog_entry *>::value,
-		      "EntryT must be a derivate of ilog_entry");
+	std::ifstream infile(inpath, std::fstream::binary);
+	std::string sample(AVS_DETECT_SAMPLE_SIZE, '\0');
 
-	EntryT entry;
-	std::string strbuf(entry.max_size(), ' ');
-	char *buf = const_cast<char *>(strbuf.data());
-	int prevpos;
+	infile.read(&sample[0], sample.size());
+	sample.resize(infile.gcount());
 
-	// cache for optimized access to entry information
-	entry.assign_ptr(buf);
-	uint32_t *data = (uint32_t *)(buf + entry.hdr_size());
+	size_t spt_score = score_logdump<log_entry_spt>(sample, spt);
+	size_t icl_score = score_logdump<log_entry_icl>(sample, icl);
 
-	while (in.good()) {
-		typename std::map<uint64_t, LiteralT>::iterator found;
-		std::map<uint64_t, LiteralT> *cache;
-		size_t size = entry.size(in.peek());
+	if (spt_score == icl_score)
+		throw std::runtime_error("Unable to detect trace format, use --format");
+	return spt_score > icl_score ? "spt" : "icl";
+}
 
-		prevpos = in.tellg();
+struct work_options {
+	std::string inpath;
+	std::vector<std::string> inpaths; // all of them, if following several
+	bool merge;
+	std::string sockpath; // empty if not serving
+	std::string grep; // empty if not searching
+	std::string outpath; // empty if not writing to a file
+	std::string checkpoint; // empty if progress is not saved
+	std::string index; // empty if not querying an index
+	std::string extract; // empty if not extracting entries
+	struct index_selection select;
+	std::vector<std::string> select_sites;
+	std::vector<std::string> select_levels;
+	bool demux;
+	enum demux_by demux_by;
+	std::vector<std::string> spans;
+	size_t top; // 0 if not profiling
+	uint64_t rate_window;
+	bool sampling;
+	struct sample_spec sample;
+	bool detect_loss;
+	uint64_t max_gap; // 0 if gaps are not reported
+	bool follow;
+	bool recording; // as a flight recorder
+	struct flight_spec flight;
+	std::vector<std::string> trigger_sites;
+	struct flush_policy flush;
+	bool circular; // input is a dump of a circular log window
+	bool ring; // input is a log window rather than a file
+};
 
-		in.read(buf, size);
-		if (in.fail() | in.eof())
-			break;
+// <lib_id>:<key>, key in the format's own notation
+template <class EntryT>
+static void parse_site(const std::string &site, uint32_t &lib, uint64_t &key)
+{
+	size_t colon = site.find(':');
+	char *end;
 
-		if (!entry.is_valid()) {
-			in.seekg(prevpos + sizeof(uint32_t));
-			continue;
-		}
+	if (colon != std::string::npos) {
+		lib = strtoul(site.c_str(), &end, 0);
+		if (end == site.c_str() + colon && EntryT::parse_key(site.substr(colon + 1), key))
+			return;
+	}
 
-		auto mit = dict.find(entry.lib_id());
-		if (mit == dict.end())
-			goto skipover;
+	throw std::invalid_argument("Invalid site '" + site + "'");
+}
 
-		cache = &mit->second;
-		found = cache->find(entry.key());
-		if (found != cache->end()) {
-			if (write_entry(out, &found->second, entry, data) < 0)
-				return;
-			continue;
-		}
+// Decimal, hexadecimal with 0x prefix or octal with 0 prefix.
+template <typename T>
+static T parse_number(const std::string &str, const char *what)
+{
+	char *end;
+	unsigned long long val = strtoull(str.c_str(), &end, 0);
+
+	if (str.empty() || *end || val > std::numeric_limits<T>::max())
+		throw std::invalid_argument(std::string("Invalid ") + what + " '" + str + "'");
+	return (T)val;
+}
+
+// <begin site>,<end site>
+template <class EntryT>
+static struct span_def parse_span(const std::string &spec)
+{
+	size_t comma = spec.find(',');
+	struct span_def def;
+
+	if (comma == std::string::npos)
+		throw std::invalid_argument("Invalid span '" + spec + "'");
+
+	def.name = spec;
+	parse_site<EntryT>(spec.substr(0, comma), def.begin_lib, def.begin_key);
+	parse_site<EntryT>(spec.substr(comma + 1), def.end_lib, def.end_key);
+	return def;
+}
+
+/*
+ * Loads progress saved by the previous run, if any, and validates it
+ * against the trace, the symbol files and the output. Text written past
+ * the checkpoint is dropped from the output as it is going to be decoded
+ * again.
+ */
+template <typename LiteralT>
+static std::unique_ptr<checkpointer> resume(const struct work_options &opts,
+					    const dictionary<LiteralT> &dict)
+{
+	struct checkpoint cp = {};
+	boost::system::error_code ec;
+	uint64_t identity;
+	int ret;
+
+	ret = load_checkpoint(opts.checkpoint, cp);
+	if (ret == -ENOENT)
+		return std::unique_ptr<checkpointer>(new checkpointer(opts.checkpoint, opts.inpath,
+								      checkpoint()));
+	if (ret < 0)
+		throw std::runtime_error("Malformed checkpoint " + opts.checkpoint);
+
+	ret = trace_identity(opts.inpath, cp.offset, identity);
+	if (ret < 0 || identity != cp.identity)
+		throw std::runtime_error("Checkpoint does not match " + opts.inpath +
+					 ", remove it to start over.");
+	if (cp.dictionary != dictionary_fingerprint(dict))
+		throw std::runtime_error("Checkpoint was saved with other symbol files, "
+					 "remove it to start over.");
+
+	if (!opts.outpath.empty()) {
+		uintmax_t size = boost::filesystem::file_size(opts.outpath, ec);
+
+		if (ec || size < cp.output)
+			throw std::runtime_error("Output is missing text of checkpoint, "
+						 "remove it to start over.");
+		boost::filesystem::resize_file(opts.outpath, cp.output, ec);
+		if (ec)
+			throw std::runtime_error("Failed to truncate " + opts.outpath + ": " +
+						 ec.message());
+	}
+
+	std::cerr << "resuming at offset " << (unsigned long long)cp.offset
+		  << ", last timestamp " << (unsigned long long)cp.timestamp << std::endl;
+	return std::unique_ptr<checkpointer>(new checkpointer(opts.checkpoint, opts.inpath, cp));
+}
 
-	skipover:
-		out << "Unknown record at position: " << prevpos << std::endl;
-		// skip over bogus data (DWORD-aligned) and re-attempt parsing
-		in.seekg(prevpos + sizeof(uint32_t));
+template <class EntryT>
+static void do_ring_work(dictionary_slot<typename EntryT::literal_type> &slot,
+			 std::vector<detailed_path> &paths,
+			 const struct work_options &opts, std::ostream *out)
+{
+#if defined(AVS_HAVE_SHM_RING)
+	shm_ring ring;
+	int ret;
+
+	ret = ring.open(opts.inpath, EntryT::max_size());
+	if (ret < 0)
+		throw std::runtime_error("Failed to attach to ring " + opts.inpath + ": " +
+					 std::to_string(ret));
+
+	dictionary_reloader<typename EntryT::literal_type> reloader(slot, paths);
+	std::unique_ptr<loss_detector> loss;
+
+	if (opts.detect_loss)
+		loss.reset(new loss_detector(ring.tail(), opts.max_gap));
+
+	ret = process_ring<EntryT>(ring, *out, slot, loss.get(), opts.flush);
+	if (ret < 0)
+		std::cerr << "ring processing failed: " << ret << std::endl;
+	if (loss)
+		loss->report(std::cerr, ring.head());
+#else
+	throw std::logic_error("--ring is not supported on this platform.");
+#endif
+}
+
+// Copies selected entries of the trace into a trace of their own.
+template <class EntryT>
+static void do_extract_work(itrace_reader &reader,
+			    dictionary_slot<typename EntryT::literal_type> &slot,
+			    const struct work_options &opts)
+{
+	struct index_selection sel = opts.select;
+	struct extract_stats stats;
+	std::ofstream out;
+	int ret;
+
+	for (auto it = opts.select_sites.begin(); it != opts.select_sites.end(); it++) {
+		std::pair<uint32_t, uint64_t> site;
+
+		parse_site<EntryT>(*it, site.first, site.second);
+		sel.sites.push_back(site);
 	}
+
+	record_filter<EntryT> filter(sel, opts.select_levels);
+
+	out.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+	out.open(opts.extract, std::ios::binary | std::ios::trunc);
+
+	ret = extract_logdump<EntryT>(reader, out, slot, filter, stats);
+	if (ret < 0)
+		std::cerr << "read failed: " << ret << std::endl;
+	out.close();
+
+	std::cerr << "kept " << stats.kept << " of " << stats.entries << " entries, "
+		  << stats.kept_bytes << " bytes, dropped " << stats.dropped_bytes
+		  << " bytes of unknown data" << std::endl;
 }
 
-template <typename LiteralT, class EntryT>
-static void do_work(std::vector<detailed_path> &paths,
-		    const std::string &inpath, std::ostream &out,
-		    bool follow)
+/*
+ * Records the trace as a flight recorder, following it if asked to, in
+ * which case recording ends once interrupted.
+ */
+template <class EntryT>
+static void do_flight_work(itrace_reader &reader,
+			   dictionary_slot<typename EntryT::literal_type> &slot,
+			   std::vector<detailed_path> &paths,
+			   const struct work_options &opts, std::ostream *out)
 {
-	std::map<int, std::map<uint64_t, LiteralT>> dict;
-	std::map<uint64_t, LiteralT> provider;
+	struct flight_spec spec = opts.flight;
+	int ret;
 
-	for (auto it = paths.begin(); it != paths.end(); it++) {
-		build_provider(provider, it->path);
-		dict[it->lib_id] = provider;
+	for (auto it = opts.trigger_sites.begin(); it != opts.trigger_sites.end(); it++) {
+		std::pair<uint32_t, uint64_t> site;
+
+		parse_site<EntryT>(*it, site.first, site.second);
+		spec.sites.push_back(site);
 	}
 
-	std::ifstream infile(inpath, std::fstream::binary);
+	flight_recorder<EntryT> recorder(spec);
 
-	if (!follow) {
-		process_logdump<LiteralT, EntryT>(infile, out, dict);
+	if (!opts.follow) {
+		ret = flight_logdump<EntryT>(reader, *out, slot, recorder);
+		if (ret < 0)
+			std::cerr << "read failed: " << ret << std::endl;
+		recorder.report(std::cerr);
 		return;
 	}
 
-	fileupdate_listener listener;
-	listener.subscribe(inpath);
+	std::unique_ptr<ifileupdate_listener> listener = open_fileupdate_listener(opts.inpath);
+	std::mutex listener_mutex;
+	bool interrupted = false;
 
-	while (1) {
-		int prevpos;
+	if (!listener)
+		throw std::runtime_error("Failed to subscribe for " + opts.inpath + " updates");
 
-		process_logdump<LiteralT, EntryT>(infile, out, dict);
-		prevpos = infile.tellg();
-		out.flush();
+	// before any thread is created, so none of them is interrupted
+	signal_waiter waiter([&] {
+		std::lock_guard<std::mutex> lock(listener_mutex);
 
-		if (!infile.eof())
-			break;
+		interrupted = true;
+		listener->interrupt();
+	});
 
-		int ret = listener.wait_for_signal();
-		if (ret) {
-			std::cout << "wait for signal failed: " << ret << std::endl;
-			break;
+	dictionary_reloader<typename EntryT::literal_type> reloader(slot, paths);
+
+	ret = flight_logdump<EntryT>(reader, *out, slot, recorder, listener.get());
+	{
+		std::lock_guard<std::mutex> lock(listener_mutex);
+
+		if (ret < 0 && !interrupted)
+			std::cerr << "read failed: " << ret << std::endl;
+	}
+	recorder.report(std::cerr);
+}
+
+/*
+ * Answers the query from the index of the trace, built first unless found
+ * matching the trace and the symbol files already.
+ */
+template <class EntryT>
+static void do_index_work(dictionary_slot<typename EntryT::literal_type> &slot,
+			  const struct work_options &opts, std::ostream *out)
+{
+	const dictionary<typename EntryT::literal_type> &dict = *slot.get();
+	struct index_selection sel = opts.select;
+	struct index_identity id, built;
+	std::vector<uint32_t> rows;
+	trace_index index;
+	uint64_t read;
+	int ret;
+
+	for (auto it = opts.select_sites.begin(); it != opts.select_sites.end(); it++) {
+		std::pair<uint32_t, uint64_t> site;
+		uint32_t packed;
+
+		parse_site<EntryT>(*it, site.first, site.second);
+		packed = EntryT::pack_key(site.second);
+		// key no entry can carry matches nothing
+		site.second = EntryT::unpack_key(packed) == site.second ? packed : UINT64_MAX;
+		sel.sites.push_back(site);
+	}
+
+	id.trace_size = boost::filesystem::file_size(opts.inpath);
+	ret = trace_identity(opts.inpath, id.trace_size, id.trace);
+	if (ret < 0)
+		throw std::runtime_error("Failed to read " + opts.inpath + ": " +
+					 std::to_string(ret));
+	id.mtime = boost::filesystem::last_write_time(opts.inpath);
+	id.dictionary = dictionary_fingerprint(dict);
+
+	ret = index.load(opts.index, built);
+	if (ret < 0 || built.trace_size != id.trace_size || built.trace != id.trace ||
+	    built.mtime != id.mtime || built.dictionary != id.dictionary) {
+		std::unique_ptr<itrace_reader> reader = open_trace_reader(opts.inpath);
+
+		index = trace_index();
+		ret = build_index<EntryT>(*reader, dict, index);
+		if (ret < 0)
+			throw std::runtime_error("Failed to index " + opts.inpath + ": " +
+						 std::to_string(ret));
+		ret = index.save(opts.index, id);
+		if (ret < 0)
+			throw std::runtime_error("Failed to save " + opts.index + ": " +
+						 std::to_string(ret));
+		std::cerr << "indexed " << index.size() << " records into " << opts.index
+			  << std::endl;
+	}
+
+	index.select(sel, rows);
+
+	std::ifstream trace(opts.inpath, std::ios::binary);
+
+	ret = query_index<EntryT>(trace, index, rows, *out, dict, read);
+	if (ret < 0)
+		std::cerr << "read failed: " << ret << std::endl;
+	std::cerr << "selected " << rows.size() << " of " << index.size() << " records, read "
+		  << read << " of " << id.trace_size << " bytes" << std::endl;
+}
+
+template <class EntryT>
+static void do_multi_work(dictionary_slot<typename EntryT::literal_type> &slot,
+			  std::vector<detailed_path> &paths,
+			  const struct work_options &opts, std::ostream *out)
+{
+#if defined(AVS_HAVE_WATCH_SET)
+	typedef typename EntryT::literal_type LiteralT;
+
+	std::mutex follower_mutex;
+	multi_follower<EntryT> *running = nullptr;
+	bool interrupted = false;
+
+	// before any thread is created, so none of them is interrupted
+	signal_waiter waiter([&] {
+		std::lock_guard<std::mutex> lock(follower_mutex);
+
+		interrupted = true;
+		if (running)
+			running->finish();
+	});
+
+	dictionary_reloader<LiteralT> reloader(slot, paths);
+	multi_follower<EntryT> follower(opts.inpaths, opts.merge ? out : nullptr, opts.outpath,
+					slot, opts.flush);
+
+	{
+		std::lock_guard<std::mutex> lock(follower_mutex);
+
+		running = &follower;
+		if (interrupted)
+			follower.finish();
+	}
+
+	follower.run();
+
+	{
+		std::lock_guard<std::mutex> lock(follower_mutex);
+
+		running = nullptr;
+	}
+#else
+	throw std::logic_error("Following several inputs is not supported on this platform.");
+#endif
+}
+
+template <class EntryT>
+static void do_work(dictionary<typename EntryT::literal_type> *dict,
+		    std::vector<detailed_path> &paths,
+		    const struct work_options &opts, std::ostream *out)
+{
+	typedef typename EntryT::literal_type LiteralT;
+
+	dictionary_slot<LiteralT> slot(dict);
+
+	if (opts.ring) {
+		do_ring_work<EntryT>(slot, paths, opts, out);
+		return;
+	}
+	if (opts.inpaths.size() > 1) {
+		do_multi_work<EntryT>(slot, paths, opts, out);
+		return;
+	}
+	if (!opts.index.empty()) {
+		do_index_work<EntryT>(slot, opts, out);
+		return;
+	}
+
+	std::unique_ptr<itrace_reader> reader;
+	std::unique_ptr<loss_detector> loss;
+	std::unique_ptr<checkpointer> ckpt;
+
+	if (opts.sampling && opts.sample.mode == SAMPLE_BLOCKS) {
+		// reads queued ahead by other readers would dwarf the bursts
+		reader.reset(new trace_reader_stream());
+		if (reader->open(opts.inpath))
+			throw std::runtime_error("Failed to open " + opts.inpath);
+	} else {
+		reader = open_trace_reader(opts.inpath);
+	}
+
+	if (opts.circular) {
+		struct circular_window win;
+		int ret;
+
+		ret = find_wrap<EntryT>(*reader, *slot.get(), win);
+		if (ret < 0)
+			throw std::runtime_error("Failed to scan " + opts.inpath + ": " +
+						 std::to_string(ret));
+
+		reader.reset(new circular_reader(std::move(reader), win));
+	}
+
+	if (!opts.checkpoint.empty()) {
+		ckpt = resume(opts, *slot.get());
+		reader->seek(ckpt->start().offset);
+	}
+
+	if (opts.detect_loss)
+		loss.reset(new loss_detector(reader->tell(), opts.max_gap));
+
+	if (opts.recording) {
+		do_flight_work<EntryT>(*reader, slot, paths, opts, out);
+		return;
+	}
+	if (!opts.extract.empty()) {
+		do_extract_work<EntryT>(*reader, slot, opts);
+		return;
+	}
+
+	if (!opts.follow) {
+		int ret;
+
+		if (!opts.grep.empty()) {
+			grep_filter<LiteralT> filter(opts.grep);
+
+			ret = grep_logdump<EntryT>(*reader, *out, slot, filter);
+		} else if (!opts.spans.empty()) {
+			std::vector<struct span_def> defs;
+
+			for (auto it = opts.spans.begin(); it != opts.spans.end(); it++)
+				defs.push_back(parse_span<EntryT>(*it));
+
+			span_tracker<LiteralT> tracker(defs);
+
+			ret = span_logdump<EntryT>(*reader, slot, tracker);
+			tracker.report(*out);
+		} else if (opts.top) {
+			site_profiler<LiteralT> profiler(opts.rate_window);
+			uint64_t total;
+
+			ret = profile_logdump<EntryT>(*reader, slot, profiler, total);
+			profiler.report(*out, opts.top, total);
+		} else if (opts.sampling && opts.sample.mode == SAMPLE_BLOCKS) {
+			uint64_t size = boost::filesystem::file_size(opts.inpath);
+
+			ret = sample_blocks<EntryT>(*reader, size, *out, slot, opts.sample);
+		} else if (opts.sampling) {
+			ret = sample_logdump<EntryT>(*reader, *out, slot, opts.sample);
+		} else if (opts.demux) {
+			if (!EntryT::can_demux(opts.demux_by))
+				throw std::logic_error("Trace format does not allow for such "
+						       "demux.");
+
+			demux_writer writer(opts.outpath, opts.demux_by);
+
+			ret = demux_logdump<EntryT>(*reader, slot, writer, opts.demux_by,
+						    loss.get());
+			writer.close();
+		} else {
+			ret = process_logdump<EntryT>(*reader, *out, slot, loss.get());
 		}
+		if (ret < 0)
+			std::cerr << "read failed: " << ret << std::endl;
+		if (loss)
+			loss->report(std::cerr, reader->tell());
+		return;
+	}
 
-		infile.clear();
-		infile.seekg(prevpos, std::ios_base::beg);
-		if (infile.tellg() == -1)
-			break;
+	std::mutex pipeline_mutex;
+	follow_pipeline<EntryT> *running = nullptr;
+	bool interrupted = false;
+
+	// before any thread is created, so none of them is interrupted
+	signal_waiter waiter([&] {
+		std::lock_guard<std::mutex> lock(pipeline_mutex);
+
+		interrupted = true;
+		if (running)
+			running->finish();
+	});
+
+	// symbol files change whenever firmware is reflashed
+	dictionary_reloader<LiteralT> reloader(slot, paths);
+	std::unique_ptr<irecord_sink> server;
+
+	if (!opts.sockpath.empty()) {
+#if defined(AVS_HAVE_LOG_SERVER)
+		server.reset(new log_server(opts.sockpath));
+#else
+		throw std::logic_error("--serve is not supported on this platform.");
+#endif
+	}
+
+	follow_pipeline<EntryT> pipeline(*reader, opts.inpath, out, slot, server.get(),
+					 loss.get(), ckpt.get(), opts.flush);
+
+	{
+		std::lock_guard<std::mutex> lock(pipeline_mutex);
+
+		running = &pipeline;
+		if (interrupted)
+			pipeline.finish();
 	}
 
-	listener.unsubscribe();
+	pipeline.run();
+
+	{
+		std::lock_guard<std::mutex> lock(pipeline_mutex);
+
+		running = nullptr;
+	}
+	if (loss)
+		loss->report(std::cerr, reader->tell());
 }
 
 int main(int argc, char* argv[])
@@ -170,15 +630,87 @@ int main(int argc, char* argv[])
 		desc.add_options()
 			("help", "Display this information")
 			("version,v", "Print the version number")
-			("input,i", value<std::string>()->required(),
-			 "Firmware trace binary file to parse")
+			("input,i", value<std::vector<std::string>>()->required(),
+			 "Firmware trace binary file to parse, may be given several times "
+			 "when following")
+			("merge", "When following several inputs, write text of all of them "
+			 "into one output ordered by timestamp, each line prefixed with its input; "
+			 "otherwise text goes to <output>.<input file name>")
 			("output,o", value<std::string>(),
 			 "File to dump parsed text into")
 			("csv", value<std::vector<detailed_path>>(),
 			 "CSV symbol cache (in <path>:<lib_id> format)")
 			("elf", value<std::vector<detailed_path>>(),
 			 "ELF symbol cache (in <path>:<lib_id> format)")
+			("format", value<std::string>()->default_value("auto"),
+			 "Trace format: spt, icl or auto to detect it from the trace")
 			("follow,f", "Monitor the input file")
+			("grep", value<std::string>(),
+			 "Print only records matching given ECMAScript regular expression")
+			("demux", value<std::string>(),
+			 "Split parsed text by core, lib or module into <output>.<stream> files")
+			("span", value<std::vector<std::string>>(),
+			 "Measure time between entries of two sites, each given as "
+			 "<lib_id>:<key>, comma-separated; key is <file_id>:<line_num> for spt "
+			 "and <entry_id> for icl")
+			("top", value<size_t>(),
+			 "Profile log sites, list given number of those logging the most bytes")
+			("rate-window", value<uint64_t>()->default_value(AVS_PROFILE_WINDOW),
+			 "Timestamp ticks peak rates of --top are counted over")
+			("sample", value<std::string>(),
+			 "Decode a part of the trace only: every:<n> for every Nth entry, "
+			 "fraction:<f> for a random fraction of entries, or "
+			 "blocks:<count>[:<bytes>] for bursts at evenly spaced points")
+			("detect-loss", "Report skipped data and timestamps going back inline, "
+			 "summarize once done")
+			("max-gap", value<uint64_t>(),
+			 "Also report timestamp increases above given value, implies --detect-loss")
+			("circular", "Input is a dump of a circular log window, decode it from "
+			 "the oldest entry on; positions past the end of the dump wrap around")
+			("ring", "Input is a memory-mapped log window, decode it as the "
+			 "producer fills it")
+			("flush-latency", value<unsigned int>()->default_value(AVS_FLUSH_LATENCY),
+			 "When following, longest time text may wait for being flushed under "
+			 "load, in microseconds")
+			("flush-batch", value<size_t>()->default_value(AVS_FLUSH_BATCH),
+			 "When following, most text coalesced before being flushed under load, "
+			 "in bytes")
+			("index", value<std::string>(),
+			 "Select records with the index of the trace kept in given file, "
+			 "built first if missing or stale")
+			("extract", value<std::string>(),
+			 "Copy selected records, unchanged and without unknown data, into "
+			 "a new trace at given path")
+			("lib", value<std::vector<std::string>>(),
+			 "With --index or --extract, select records of given library")
+			("site", value<std::vector<std::string>>(),
+			 "With --index or --extract, select records of given site, as in --span")
+			("core", value<std::vector<uint32_t>>(),
+			 "With --index or --extract, select records of given core")
+			("time", value<std::string>(),
+			 "With --index or --extract, select records of timestamps within "
+			 "<from>,<to>, inclusive; either one may be omitted")
+			("level", value<std::vector<std::string>>(),
+			 "With --extract, select records of given level, as in --trigger-level")
+			("flight", value<uint64_t>(),
+			 "Act as a flight recorder: keep given number of entries undecoded, "
+			 "decode them only once a trigger is found")
+			("flight-time", value<uint64_t>(),
+			 "Act as a flight recorder keeping entries of given number of timestamp "
+			 "ticks rather than a number of them")
+			("flight-after", value<uint64_t>()->default_value(AVS_FLIGHT_AFTER),
+			 "Number of entries a flight recorder decodes past the trigger")
+			("trigger-level", value<std::vector<std::string>>(),
+			 "Level of entries triggering the flight recorder, as named in the "
+			 "symbol file for spt or numeric for icl")
+			("trigger-site", value<std::vector<std::string>>(),
+			 "Site of entries triggering the flight recorder, as in --span")
+			("checkpoint", value<std::string>(),
+			 "Save progress of following to given file every now and then, resume "
+			 "from it once restarted")
+			("serve", value<std::string>(),
+			 "Monitor the input file and stream parsed records to subscribers "
+			 "of the UNIX socket at given path")
 		;
 
 		variables_map vm;
@@ -197,30 +729,257 @@ int main(int argc, char* argv[])
 		}
 
 		notify(vm);
-		conflicting_options(vm, "csv", "elf");
 
+		std::unique_ptr<char[]> outbuf;
 		std::ofstream outfile;
 		std::ostream *out;
-		std::string inpath = vm["input"].as<std::string>();
-		bool follow = vm.count("follow");
+		struct work_options opts;
+
+		opts.inpaths = vm["input"].as<std::vector<std::string>>();
+		opts.inpath = opts.inpaths.front();
+		opts.follow = vm.count("follow") || vm.count("serve");
+		opts.ring = vm.count("ring");
+		opts.merge = vm.count("merge");
+		if (opts.inpaths.size() > 1) {
+			if (!opts.follow || opts.ring)
+				throw std::logic_error("Several inputs can be followed only.");
+			if (!opts.merge && !vm.count("output"))
+				throw std::logic_error("Following several inputs requires --merge "
+						       "or --output.");
+			for (const char *opt : { "serve", "checkpoint", "detect-loss", "max-gap" })
+				if (vm.count(opt))
+					throw std::logic_error(std::string("--") + opt +
+							       " applies to a single input only.");
+		} else if (opts.merge) {
+			throw std::logic_error("--merge applies to following several inputs only.");
+		}
+		opts.flush.max_latency =
+			std::chrono::microseconds(vm["flush-latency"].as<unsigned int>());
+		opts.flush.max_batch = vm["flush-batch"].as<size_t>();
+		opts.circular = vm.count("circular");
+		if (opts.circular && (opts.follow || opts.ring))
+			throw std::logic_error("--circular applies to complete traces only.");
+		if (opts.ring && vm.count("serve"))
+			throw std::logic_error("--ring and --serve cannot be combined.");
+		if (vm.count("checkpoint")) {
+			opts.checkpoint = vm["checkpoint"].as<std::string>();
+			if (!opts.follow || opts.ring)
+				throw std::logic_error("--checkpoint applies to following only.");
+		}
+		if (vm.count("grep")) {
+			opts.grep = vm["grep"].as<std::string>();
+			if (opts.follow || opts.ring)
+				throw std::logic_error("--grep applies to complete traces only.");
+		}
 
-		if (vm.count("output")) {
+		if (vm.count("span")) {
+			opts.spans = vm["span"].as<std::vector<std::string>>();
+			if (opts.follow || opts.ring || vm.count("grep"))
+				throw std::logic_error("--span applies to complete traces only.");
+		}
+
+		opts.top = vm.count("top") ? vm["top"].as<size_t>() : 0;
+		opts.rate_window = vm["rate-window"].as<uint64_t>();
+		if (vm.count("top")) {
+			if (!opts.top || !opts.rate_window)
+				throw std::logic_error("--top and --rate-window must not be 0.");
+			if (opts.follow || opts.ring || vm.count("grep") || vm.count("span") ||
+			    vm.count("demux") || vm.count("sample"))
+				throw std::logic_error("--top applies to complete traces only.");
+		}
+
+		opts.sampling = vm.count("sample");
+		if (opts.sampling) {
+			opts.sample = parse_sample(vm["sample"].as<std::string>());
+			if (opts.follow || opts.ring || vm.count("grep") || vm.count("span") ||
+			    vm.count("demux"))
+				throw std::logic_error("--sample applies to complete traces only.");
+			if (opts.circular && opts.sample.mode == SAMPLE_BLOCKS)
+				throw std::logic_error("Circular dumps cannot be sampled "
+						       "in blocks.");
+		}
+
+		if (vm.count("index")) {
+			opts.index = vm["index"].as<std::string>();
+			if (opts.follow || opts.ring || opts.circular)
+				throw std::logic_error("--index applies to complete traces only.");
+			for (const char *opt : { "grep", "span", "top", "sample", "demux",
+						 "detect-loss", "max-gap" })
+				if (vm.count(opt))
+					throw std::logic_error(std::string("--index and --") + opt +
+							       " cannot be combined.");
+		}
+		if (vm.count("extract")) {
+			opts.extract = vm["extract"].as<std::string>();
+			if (opts.follow || opts.ring)
+				throw std::logic_error("--extract applies to complete traces "
+						       "only.");
+			for (const char *opt : { "output", "grep", "span", "top", "sample", "demux",
+						 "index", "detect-loss", "max-gap" })
+				if (vm.count(opt))
+					throw std::logic_error(std::string("--extract and --") +
+							       opt + " cannot be combined.");
+		}
+		for (const char *opt : { "lib", "site", "core", "time" })
+			if (vm.count(opt) && !vm.count("index") && !vm.count("extract"))
+				throw std::logic_error(std::string("--") + opt +
+						       " requires --index or --extract.");
+		if (vm.count("level")) {
+			if (!vm.count("extract"))
+				throw std::logic_error("--level requires --extract.");
+			opts.select_levels = vm["level"].as<std::vector<std::string>>();
+		}
+		if (vm.count("lib")) {
+			std::vector<std::string> libs = vm["lib"].as<std::vector<std::string>>();
+
+			for (auto it = libs.begin(); it != libs.end(); it++)
+				opts.select.libs.push_back(parse_number<uint32_t>(*it, "library"));
+		}
+		if (vm.count("site"))
+			opts.select_sites = vm["site"].as<std::vector<std::string>>();
+		if (vm.count("core"))
+			opts.select.cores = vm["core"].as<std::vector<uint32_t>>();
+		if (vm.count("time")) {
+			std::string range = vm["time"].as<std::string>();
+			size_t comma = range.find(',');
+
+			if (comma == std::string::npos)
+				throw std::invalid_argument("Invalid time range '" + range + "'");
+			if (comma)
+				opts.select.from = parse_number<uint64_t>(range.substr(0, comma),
+									  "timestamp");
+			if (comma + 1 < range.size())
+				opts.select.to = parse_number<uint64_t>(range.substr(comma + 1),
+									"timestamp");
+		}
+
+		opts.recording = vm.count("flight") || vm.count("flight-time");
+		if (opts.recording) {
+			if (vm.count("flight") && vm.count("flight-time"))
+				throw std::logic_error("--flight and --flight-time cannot be "
+						       "combined.");
+			opts.flight.before = vm.count("flight") ? vm["flight"].as<uint64_t>() : 0;
+			opts.flight.span = vm.count("flight-time") ?
+					   vm["flight-time"].as<uint64_t>() : 0;
+			opts.flight.after = vm["flight-after"].as<uint64_t>();
+			if (vm.count("flight") && !opts.flight.before)
+				throw std::logic_error("--flight must not be 0.");
+			if (vm.count("trigger-level"))
+				opts.flight.levels =
+					vm["trigger-level"].as<std::vector<std::string>>();
+			if (vm.count("trigger-site"))
+				opts.trigger_sites =
+					vm["trigger-site"].as<std::vector<std::string>>();
+			if (opts.flight.levels.empty() && opts.trigger_sites.empty())
+				throw std::logic_error("Flight recorder requires --trigger-level "
+						       "or --trigger-site.");
+			if (opts.ring || opts.inpaths.size() > 1)
+				throw std::logic_error("Flight recorder applies to a single trace "
+						       "file only.");
+			for (const char *opt : { "serve", "checkpoint", "grep", "span", "top",
+						 "sample", "demux", "index", "extract",
+						 "detect-loss", "max-gap" })
+				if (vm.count(opt))
+					throw std::logic_error("Flight recorder and --" +
+							       std::string(opt) +
+							       " cannot be combined.");
+		} else {
+			for (const char *opt : { "trigger-level", "trigger-site" })
+				if (vm.count(opt))
+					throw std::logic_error(std::string("--") + opt +
+							       " requires --flight or "
+							       "--flight-time.");
+		}
+
+		opts.detect_loss = vm.count("detect-loss") || vm.count("max-gap");
+		opts.max_gap = vm.count("max-gap") ? vm["max-gap"].as<uint64_t>() : 0;
+		if (opts.detect_loss && (vm.count("grep") || vm.count("span") || opts.sampling ||
+					 opts.top))
+			throw std::logic_error("--detect-loss applies to decoding only.");
+
+		opts.demux = vm.count("demux");
+		if (opts.demux) {
+			std::string by = vm["demux"].as<std::string>();
+
+			if (by == "core")
+				opts.demux_by = DEMUX_CORE;
+			else if (by == "lib")
+				opts.demux_by = DEMUX_LIB;
+			else if (by == "module")
+				opts.demux_by = DEMUX_MODULE;
+			else
+				throw std::logic_error("Unknown demux '" + by + "'.");
+
+			if (!vm.count("output"))
+				throw std::logic_error("--demux requires --output.");
+			if (opts.follow || opts.ring || vm.count("grep") || vm.count("span"))
+				throw std::logic_error("--demux applies to complete traces only.");
+		}
+		if (vm.count("output"))
+			opts.outpath = vm["output"].as<std::string>();
+
+		if (opts.demux || (opts.inpaths.size() > 1 && !opts.merge)) {
+			out = nullptr; // output names the files
+		} else if (vm.count("output")) {
+			std::ios_base::openmode mode = std::ios_base::out;
+
+			// resumed run continues the text, checkpoint tells where
+			if (!opts.checkpoint.empty() && boost::filesystem::exists(opts.checkpoint))
+				mode |= std::ios_base::app;
+			// let flush policy rather than the buffer decide on writes
+			outbuf.reset(new char[opts.flush.max_batch]);
+			outfile.rdbuf()->pubsetbuf(outbuf.get(), opts.flush.max_batch);
 			outfile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-			outfile.open(vm["output"].as<std::string>());
+			outfile.open(opts.outpath, mode);
 			out = &outfile;
+		} else if (vm.count("serve")) {
+			out = nullptr; // subscribers are the only consumers
 		} else {
 			out = &std::cout;
 		}
+		if (vm.count("serve"))
+			opts.sockpath = vm["serve"].as<std::string>();
+
+		std::unique_ptr<dictionary<struct log_literal1_5>> spt_dict;
+		std::unique_ptr<dictionary<struct log_literal2_0>> icl_dict;
+		std::vector<detailed_path> csv, elf;
+		std::string format = vm["format"].as<std::string>();
 
-		std::vector<detailed_path> symbols;
 		if (vm.count("csv")) {
-			symbols = vm["csv"].as<std::vector<detailed_path>>();
-			do_work<struct log_literal1_5, log_entry_spt>(symbols, inpath, *out,
-								      follow);
+			csv = vm["csv"].as<std::vector<detailed_path>>();
+			spt_dict.reset(new dictionary<struct log_literal1_5>);
+			build_dictionary(*spt_dict, csv);
+		}
+		if (vm.count("elf")) {
+			elf = vm["elf"].as<std::vector<detailed_path>>();
+			icl_dict.reset(new dictionary<struct log_literal2_0>);
+			build_dictionary(*icl_dict, elf);
+		}
+
+		if (format == "auto") {
+			if (!icl_dict)
+				format = "spt";
+			else if (!spt_dict)
+				format = "icl";
+			else if (opts.ring)
+				throw std::logic_error("Format of a ring cannot be detected, "
+						       "use --format.");
+			else
+				format = detect_format(opts.inpath, *spt_dict, *icl_dict);
+		}
+
+		if (format == "spt") {
+			if (!spt_dict)
+				throw std::logic_error("Format 'spt' requires --csv.");
+			icl_dict.reset();
+			do_work<log_entry_spt>(spt_dict.release(), csv, opts, out);
+		} else if (format == "icl") {
+			if (!icl_dict)
+				throw std::logic_error("Format 'icl' requires --elf.");
+			spt_dict.reset();
+			do_work<log_entry_icl>(icl_dict.release(), elf, opts, out);
 		} else {
-			symbols = vm["elf"].as<std::vector<detailed_path>>();
-			do_work<struct log_literal2_0, log_entry_icl>(symbols, inpath, *out,
-								      follow);
+			throw std::logic_error("Unknown format '" + format + "'.");
 		}
 	} catch (error &poe) {
 		std::cout << poe.what();
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include "sample.hpp"
+
+struct sample_spec parse_sample(const std::string &spec)
+{
+	struct sample_spec s = {};
+	size_t colon = spec.find(':');
+	std::string mode = spec.substr(0, colon);
+	const char *arg = colon != std::string::npos ? spec.c_str() + colon + 1 : "";
+	char *end;
+
+	if (mode == "every") {
+		s.mode = SAMPLE_EVERY;
+		s.every = strtoull(arg, &end, 0);
+		if (*arg && !*end && s.every)
+			return s;
+	} else if (mode == "fraction") {
+		s.mode = SAMPLE_FRACTION;
+		s.fraction = strtod(arg, &end);
+		if (*arg && !*end && s.fraction > 0 && s.fraction <= 1)
+			return s;
+	} else if (mode == "blocks") {
+		unsigned long long burst = AVS_SAMPLE_BURST;
+
+		s.mode = SAMPLE_BLOCKS;
+		s.blocks = strtoull(arg, &end, 0);
+		if (*end == ':')
+			burst = strtoull(end + 1, &end, 0);
+		s.burst = (size_t)burst;
+		// a burst is decoded as a single block
+		if (*arg && !*end && s.blocks && burst && burst <= AVS_CHUNK_SIZE)
+			return s;
+	}
+
+	throw std::invalid_argument("Invalid sampling '" + spec + "'");
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "shm_ring.hpp"
+
+#if defined(AVS_HAVE_SHM_RING)
+
+#include <string>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+shm_ring::shm_ring()
+	: hdr(nullptr), data_area(nullptr), base(MAP_FAILED), length(0)
+{
+}
+
+shm_ring::~shm_ring()
+{
+	release();
+}
+
+void shm_ring::release()
+{
+	if (base != MAP_FAILED)
+		munmap(base, length);
+	base = MAP_FAILED;
+	hdr = nullptr;
+	data_area = nullptr;
+}
+
+static int map_at(char *addr, size_t len, int prot, int fd, off_t off)
+{
+	void *ptr = mmap(addr, len, prot, MAP_SHARED | MAP_FIXED, fd, off);
+
+	return ptr == MAP_FAILED ? -errno : 0;
+}
+
+int shm_ring::open(const std::string &path, size_t overreach)
+{
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	struct ring_header h;
+	struct stat st;
+	char *addr;
+	int fd, ret;
+
+	fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+
+	if (pread(fd, &h, sizeof(h), 0) != sizeof(h) || fstat(fd, &st)) {
+		ret = -EIO;
+		goto exit;
+	}
+
+	if (h.magic != AVS_RING_MAGIC || !h.size || (h.size & (h.size - 1)) ||
+	    h.size % page || h.data_offset < sizeof(h) || h.data_offset % page ||
+	    (uint64_t)st.st_size < (uint64_t)h.data_offset + h.size) {
+		ret = -EINVAL;
+		goto exit;
+	}
+
+	// third copy covers what formatters may read past the window
+	overreach = (overreach + page - 1) / page * page;
+	if (overreach > h.size)
+		overreach = h.size;
+
+	length = h.data_offset + 2 * (size_t)h.size + overreach;
+	base = mmap(nullptr, length, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED) {
+		ret = -errno;
+		goto exit;
+	}
+	addr = (char *)base;
+
+	// only the header is ever written to
+	ret = map_at(addr, h.data_offset + h.size, PROT_READ | PROT_WRITE, fd, 0);
+	if (!ret)
+		ret = map_at(addr + h.data_offset + h.size, h.size, PROT_READ, fd,
+			     h.data_offset);
+	if (!ret)
+		ret = map_at(addr + h.data_offset + 2 * (size_t)h.size, overreach, PROT_READ, fd,
+			     h.data_offset);
+	if (ret) {
+		release();
+		goto exit;
+	}
+
+	hdr = (struct ring_header *)addr;
+	data_area = addr + h.data_offset;
+
+exit:
+	// mappings hold their own reference to the file
+	close(fd);
+	return ret;
+}
+
+#endif // AVS_HAVE_SHM_RING
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include "signal_waiter.hpp"
+
+#if defined(__linux__)
+
+#include <pthread.h>
+#include <signal.h>
+
+signal_waiter::signal_waiter(std::function<void()> handler)
+	: on_signal(handler), exiting(false)
+{
+	sigemptyset(&set);
+	sigaddset(&set, SIGINT);
+	sigaddset(&set, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &set, &oldset);
+
+	worker = std::thread(&signal_waiter::run, this);
+}
+
+signal_waiter::~signal_waiter()
+{
+	// wake the worker with a signal of its own
+	exiting = true;
+	pthread_kill(worker.native_handle(), SIGTERM);
+	worker.join();
+
+	pthread_sigmask(SIG_SETMASK, &oldset, nullptr);
+}
+
+void signal_waiter::run()
+{
+	bool requested = false;
+	int sig;
+
+	while (!sigwait(&set, &sig)) {
+		if (exiting)
+			return;
+		// finishing got stuck, e.g.: on a blocked output
+		if (requested)
+			std::_Exit(128 + sig);
+
+		std::cerr << "signal " << sig << " received, finishing" << std::endl;
+		requested = true;
+		on_signal();
+	}
+}
+
+#elif defined(_WIN32) || defined(__CYGWIN__)
+
+#if defined(_WIN32) && !defined(NOMINMAX)
+#define NOMINMAX // fix min/max redefinition from windows.h
+#endif
+
+#include <windows.h>
+#undef NOMINMAX
+
+// console control handlers are global, so is the waiter
+static std::mutex waiter_mutex;
+static std::function<void()> *waiter_handler;
+
+// called by the system from a thread of its own
+static BOOL WINAPI console_handler(DWORD type)
+{
+	std::lock_guard<std::mutex> lock(waiter_mutex);
+
+	if (type != CTRL_C_EVENT && type != CTRL_BREAK_EVENT && type != CTRL_CLOSE_EVENT)
+		return FALSE;
+	if (!waiter_handler)
+		return FALSE;
+
+	std::cerr << "console event " << type << " received, finishing" << std::endl;
+	(*waiter_handler)();
+	return TRUE;
+}
+
+signal_waiter::signal_waiter(std::function<void()> handler)
+	: on_signal(handler), exiting(false)
+{
+	std::lock_guard<std::mutex> lock(waiter_mutex);
+
+	waiter_handler = &on_signal;
+	SetConsoleCtrlHandler(console_handler, TRUE);
+}
+
+signal_waiter::~signal_waiter()
+{
+	SetConsoleCtrlHandler(console_handler, FALSE);
+
+	std::lock_guard<std::mutex> lock(waiter_mutex);
+
+	exiting = true;
+	waiter_handler = nullptr;
+}
+
+#else
+
+signal_waiter::signal_waiter(std::function<void()> handler)
+	: on_signal(handler), exiting(false)
+{
+}
+
+signal_waiter::~signal_waiter()
+{
+}
+
+#endif
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <cstring>
+#include <string>
+#include "string_arena.hpp"
+
+string_arena::string_arena()
+	: index(0, hasher{&buf}, equal{&buf})
+{
+}
+
+size_t string_arena::hasher::operator()(uint32_t offset) const
+{
+	// FNV-1a
+	uint64_t hash = 0xcbf29ce484222325ULL;
+
+	for (const char *s = buf->data() + offset; *s; s++)
+		hash = (hash ^ (unsigned char)*s) * 0x100000001b3ULL;
+	return (size_t)hash;
+}
+
+bool string_arena::equal::operator()(uint32_t a, uint32_t b) const
+{
+	return !strcmp(buf->data() + a, buf->data() + b);
+}
+
+uint32_t string_arena::intern(const char *str, size_t len)
+{
+	uint32_t offset = (uint32_t)buf.size();
+	const char *end = (const char *)memchr(str, '\0', len);
+
+	if (end)
+		len = end - str;
+
+	// append tentatively so the candidate can be looked up in place
+	buf.insert(buf.end(), str, str + len);
+	buf.push_back('\0');
+
+	auto ret = index.insert(offset);
+	if (!ret.second)
+		buf.resize(offset);
+	return *ret.first;
+}
+
+uint32_t string_arena::append(const string_arena &other)
+{
+	uint32_t offset = (uint32_t)buf.size();
+
+	buf.insert(buf.end(), other.buf.begin(), other.buf.end());
+	return offset;
+}
+
+void string_arena::seal()
+{
+	std::unordered_set<uint32_t, hasher, equal>(0, hasher{&buf}, equal{&buf}).swap(index);
+	buf.shrink_to_fit();
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "text_template.hpp"
+
+void printf_template(std::string &tmpl, const char *fmt)
+{
+	while (*fmt) {
+		if (*fmt != '%') {
+			tmpl.push_back(*fmt++);
+			continue;
+		}
+
+		fmt++;
+		if (*fmt == '%') {
+			tmpl.push_back(*fmt++);
+			continue;
+		}
+
+		// flags, width, precision and length do not affect the outcome
+		fmt += strspn(fmt, "-+ #0123456789.*hlLqjzt");
+		if (!*fmt)
+			break;
+
+		if (strchr("diouxX", *fmt))
+			tmpl.push_back(AVS_TEMPLATE_NUMBER);
+		else if (*fmt != 'n')
+			tmpl.push_back(AVS_TEMPLATE_ANY);
+		fmt++;
+	}
+}
+
+static bool marker_accepts(char marker, char c)
+{
+	if (marker == AVS_TEMPLATE_ANY)
+		return true;
+	return c && strchr("0123456789abcdefABCDEFxX+- ", c);
+}
+
+static bool is_marker(char c)
+{
+	return c == AVS_TEMPLATE_NUMBER || c == AVS_TEMPLATE_ANY;
+}
+
+bool template_may_contain(const std::string &tmpl, const std::string &needle)
+{
+	size_t len = tmpl.size();
+	// state j: next to match is tmpl[j], markers may stand for empty text
+	std::vector<char> cur(len + 1, 1), next(len + 1);
+
+	for (size_t i = 0; i < needle.size(); i++) {
+		char c = needle[i];
+		bool alive = false;
+
+		for (size_t j = 0; j < len; j++)
+			if (cur[j] && is_marker(tmpl[j]))
+				cur[j + 1] = 1;
+
+		std::fill(next.begin(), next.end(), 0);
+		for (size_t j = 0; j < len; j++) {
+			if (!cur[j])
+				continue;
+			if (is_marker(tmpl[j])) {
+				if (marker_accepts(tmpl[j], c))
+					next[j] = alive = 1;
+			} else if (tmpl[j] == c) {
+				next[j + 1] = alive = 1;
+			}
+		}
+
+		if (!alive)
+			return false;
+		cur.swap(next);
+	}
+
+	return true;
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <boost/filesystem/operations.hpp>
+#include <cerrno>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "trace_index.hpp"
+
+struct index_header {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t count;
+	uint64_t bases;
+	struct index_identity id;
+};
+
+template <typename T>
+static void write_column(std::ofstream &file, const std::vector<T> &column)
+{
+	file.write((const char *)column.data(), column.size() * sizeof(T));
+}
+
+template <typename T>
+static uint64_t element_size(const std::vector<T> &column)
+{
+	return sizeof(T);
+}
+
+template <typename T>
+static bool read_column(std::ifstream &file, std::vector<T> &column, uint64_t count)
+{
+	column.resize(count);
+	file.read((char *)column.data(), count * sizeof(T));
+	return (uint64_t)file.gcount() == count * sizeof(T);
+}
+
+int trace_index::save(const std::string &path, const struct index_identity &id) const
+{
+	std::string tmppath = path + ".tmp";
+	struct index_header hdr = {};
+	boost::system::error_code ec;
+
+	hdr.magic = AVS_INDEX_MAGIC;
+	hdr.version = AVS_INDEX_VERSION;
+	hdr.count = size();
+	hdr.bases = bases.size();
+	hdr.id = id;
+
+	{
+		std::ofstream file(tmppath, std::ios::binary | std::ios::trunc);
+
+		file.write((const char *)&hdr, sizeof(hdr));
+		write_column(file, bases);
+		write_column(file, offsets);
+		write_column(file, timestamps);
+		write_column(file, keys);
+		write_column(file, lib_ids);
+		write_column(file, lengths);
+		write_column(file, cores);
+		file.close();
+		if (file.fail())
+			return -EIO;
+	}
+
+	// replaces existing file on all platforms, unlike std::rename()
+	boost::filesystem::rename(tmppath, path, ec);
+	if (ec)
+		return -ec.value();
+	return 0;
+}
+
+int trace_index::load(const std::string &path, struct index_identity &id)
+{
+	std::ifstream file(path, std::ios::binary);
+	struct index_header hdr;
+	boost::system::error_code ec;
+	uint64_t size, row_size;
+
+	if (!file.is_open())
+		return -ENOENT;
+	size = boost::filesystem::file_size(path, ec);
+	if (ec)
+		return -ec.value();
+
+	file.read((char *)&hdr, sizeof(hdr));
+	if (file.gcount() != sizeof(hdr) || hdr.magic != AVS_INDEX_MAGIC ||
+	    hdr.version != AVS_INDEX_VERSION)
+		return -EINVAL;
+
+	// truncated or corrupted index must not size the columns
+	row_size = element_size(offsets) + element_size(timestamps) + element_size(keys) +
+		   element_size(lib_ids) + element_size(lengths) + element_size(cores);
+	size -= sizeof(hdr);
+	if (hdr.count > UINT32_MAX || hdr.bases > size / element_size(bases) ||
+	    hdr.count > (size - hdr.bases * element_size(bases)) / row_size ||
+	    hdr.bases * element_size(bases) + hdr.count * row_size != size)
+		return -EINVAL;
+
+	if (!read_column(file, bases, hdr.bases) ||
+	    !read_column(file, offsets, hdr.count) ||
+	    !read_column(file, timestamps, hdr.count) ||
+	    !read_column(file, keys, hdr.count) ||
+	    !read_column(file, lib_ids, hdr.count) ||
+	    !read_column(file, lengths, hdr.count) ||
+	    !read_column(file, cores, hdr.count))
+		return -EINVAL;
+
+	id = hdr.id;
+	return 0;
+}
+
+void trace_index::select(const struct index_selection &sel, std::vector<uint32_t> &rows) const
+{
+	size_t count = size();
+	std::vector<uint8_t> match(count, 1), any(count);
+
+	// one criterion at a time, branchless so loops vectorize
+	if (sel.from || sel.to != UINT64_MAX)
+		for (size_t i = 0; i < count; i++)
+			match[i] &= (timestamps[i] >= sel.from) & (timestamps[i] <= sel.to);
+
+	if (!sel.libs.empty()) {
+		std::fill(any.begin(), any.end(), 0);
+		for (auto it = sel.libs.begin(); it != sel.libs.end(); it++)
+			for (size_t i = 0; i < count; i++)
+				any[i] |= lib_ids[i] == *it;
+		for (size_t i = 0; i < count; i++)
+			match[i] &= any[i];
+	}
+
+	if (!sel.sites.empty()) {
+		std::fill(any.begin(), any.end(), 0);
+		for (auto it = sel.sites.begin(); it != sel.sites.end(); it++)
+			for (size_t i = 0; i < count; i++)
+				any[i] |= (lib_ids[i] == it->first) & (keys[i] == it->second);
+		for (size_t i = 0; i < count; i++)
+			match[i] &= any[i];
+	}
+
+	if (!sel.cores.empty()) {
+		std::fill(any.begin(), any.end(), 0);
+		for (auto it = sel.cores.begin(); it != sel.cores.end(); it++)
+			for (size_t i = 0; i < count; i++)
+				any[i] |= cores[i] == *it;
+		for (size_t i = 0; i < count; i++)
+			match[i] &= any[i];
+	}
+
+	rows.clear();
+	for (size_t i = 0; i < count; i++)
+		if (match[i])
+			rows.push_back((uint32_t)i);
+}
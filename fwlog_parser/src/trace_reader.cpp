@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include "trace_reader.hpp"
+#include "trace_reader_stream.hpp"
+#include "trace_reader_uring.hpp"
+
+std::unique_ptr<itrace_reader> open_trace_reader(const std::string &path)
+{
+	std::unique_ptr<itrace_reader> reader;
+
+#if defined(AVS_HAVE_IO_URING)
+	// io_uring may be missing or disabled, fall back silently
+	reader.reset(new trace_reader_uring());
+	if (!reader->open(path))
+		return reader;
+#endif
+
+	reader.reset(new trace_reader_stream());
+	if (reader->open(path))
+		throw std::runtime_error("Failed to open " + path);
+	return reader;
+}
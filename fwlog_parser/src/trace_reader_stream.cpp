@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <cerrno>
+#include <fstream>
+#include <string>
+#include "trace_reader_stream.hpp"
+
+// dumps spanning tens of gigabytes are common
+static_assert(sizeof(std::streamoff) >= sizeof(uint64_t),
+	      "std::streamoff cannot represent 64-bit file offsets");
+
+trace_reader_stream::trace_reader_stream()
+	: buf(new char[AVS_CHUNK_SIZE]), offset(0), reposition(false)
+{
+}
+
+int trace_reader_stream::open(const std::string &path)
+{
+	file.open(path, std::fstream::binary);
+	if (!file.is_open())
+		return -ENOENT;
+
+	offset = 0;
+	return 0;
+}
+
+int trace_reader_stream::next(const char **data, size_t *len)
+{
+	if (reposition) {
+		// drop eofbit and any data buffered so the file is re-read
+		file.clear();
+		file.seekg((std::streamoff)offset, std::ios_base::beg);
+		if (file.fail())
+			return -EIO;
+		reposition = false;
+	}
+
+	file.read(buf.get(), AVS_CHUNK_SIZE);
+	if (file.bad())
+		return -EIO;
+
+	*data = buf.get();
+	*len = (size_t)file.gcount();
+	offset += *len;
+	reposition = file.eof();
+	return 0;
+}
+
+void trace_reader_stream::seek(uint64_t off)
+{
+	offset = off;
+	reposition = true;
+}
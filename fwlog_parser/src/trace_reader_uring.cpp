@@ -0,0 +1,338 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "trace_reader_uring.hpp"
+
+#if defined(AVS_HAVE_IO_URING)
+
+#include <cerrno>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// there is no glibc wrapper for io_uring, call the kernel directly
+static int io_uring_setup(unsigned int entries, struct io_uring_params *p)
+{
+	return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int io_uring_enter(int fd, unsigned int to_submit, unsigned int min_complete,
+			  unsigned int flags)
+{
+	return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int io_uring_register(int fd, unsigned int opcode, void *arg, unsigned int nr_args)
+{
+	return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+trace_reader_uring::trace_reader_uring()
+	: ring_fd(-1), file_fd(-1), fixed(false),
+	  sq_ring(MAP_FAILED), sq_ring_size(0), cq_ring(MAP_FAILED), cq_ring_size(0),
+	  sqes((struct io_uring_sqe *)MAP_FAILED), sqes_size(0), to_submit(0),
+	  buffers(nullptr), head(0), queued(0), depth(AVS_URING_DEPTH), offset(0), eof(false)
+{
+	memset(slots, 0, sizeof(slots));
+}
+
+trace_reader_uring::~trace_reader_uring()
+{
+	release();
+}
+
+void trace_reader_uring::release()
+{
+	if (ring_fd >= 0)
+		drain();
+
+	if (sqes != MAP_FAILED)
+		munmap(sqes, sqes_size);
+	if (cq_ring != MAP_FAILED && cq_ring != sq_ring)
+		munmap(cq_ring, cq_ring_size);
+	if (sq_ring != MAP_FAILED)
+		munmap(sq_ring, sq_ring_size);
+	sqes = (struct io_uring_sqe *)MAP_FAILED;
+	cq_ring = sq_ring = MAP_FAILED;
+
+	if (ring_fd >= 0)
+		close(ring_fd);
+	if (file_fd >= 0)
+		close(file_fd);
+	ring_fd = file_fd = -1;
+
+	free(buffers);
+	buffers = nullptr;
+}
+
+int trace_reader_uring::setup()
+{
+	struct io_uring_params p;
+	char probebuf[sizeof(struct io_uring_probe) +
+		      (IORING_OP_READ + 1) * sizeof(struct io_uring_probe_op)];
+	struct io_uring_probe *probe = (struct io_uring_probe *)probebuf;
+	struct iovec iov[AVS_URING_DEPTH];
+	char *ptr;
+
+	memset(&p, 0, sizeof(p));
+	ring_fd = io_uring_setup(AVS_URING_DEPTH, &p);
+	if (ring_fd < 0)
+		return -errno;
+
+	// plain, offset-based reads are required
+	memset(probebuf, 0, sizeof(probebuf));
+	if (io_uring_register(ring_fd, IORING_REGISTER_PROBE, probe, IORING_OP_READ + 1) < 0)
+		return -errno;
+	if (probe->last_op < IORING_OP_READ ||
+	    !(probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED))
+		return -EOPNOTSUPP;
+
+	sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+	cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+		sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+
+	sq_ring = mmap(NULL, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		       ring_fd, IORING_OFF_SQ_RING);
+	if (sq_ring == MAP_FAILED)
+		return -errno;
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+		cq_ring = sq_ring;
+	else
+		cq_ring = mmap(NULL, cq_ring_size, PROT_READ | PROT_WRITE,
+			       MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+	if (cq_ring == MAP_FAILED)
+		return -errno;
+
+	sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	sqes = (struct io_uring_sqe *)mmap(NULL, sqes_size, PROT_READ | PROT_WRITE,
+					   MAP_SHARED | MAP_POPULATE, ring_fd,
+					   IORING_OFF_SQES);
+	if (sqes == MAP_FAILED)
+		return -errno;
+
+	ptr = (char *)sq_ring;
+	sq_tail = (unsigned int *)(ptr + p.sq_off.tail);
+	sq_mask = (unsigned int *)(ptr + p.sq_off.ring_mask);
+	sq_array = (unsigned int *)(ptr + p.sq_off.array);
+	ptr = (char *)cq_ring;
+	cq_head = (unsigned int *)(ptr + p.cq_off.head);
+	cq_tail = (unsigned int *)(ptr + p.cq_off.tail);
+	cq_mask = (unsigned int *)(ptr + p.cq_off.ring_mask);
+	cqes = (struct io_uring_cqe *)(ptr + p.cq_off.cqes);
+
+	if (posix_memalign((void **)&buffers, 4096, AVS_URING_DEPTH * AVS_CHUNK_SIZE))
+		return -ENOMEM;
+
+	// registration is subject to RLIMIT_MEMLOCK, plain reads work regardless
+	for (unsigned int i = 0; i < AVS_URING_DEPTH; i++) {
+		iov[i].iov_base = buffers + i * AVS_CHUNK_SIZE;
+		iov[i].iov_len = AVS_CHUNK_SIZE;
+	}
+	fixed = !io_uring_register(ring_fd, IORING_REGISTER_BUFFERS, iov, AVS_URING_DEPTH);
+
+	return 0;
+}
+
+int trace_reader_uring::open(const std::string &path)
+{
+	int ret;
+
+	file_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_LARGEFILE);
+	if (file_fd < 0)
+		return -errno;
+
+	ret = setup();
+	if (ret)
+		release();
+	return ret;
+}
+
+void trace_reader_uring::submit(unsigned int slot, uint64_t off)
+{
+	unsigned int tail = *sq_tail;
+	unsigned int index = tail & *sq_mask;
+	struct io_uring_sqe *sqe = &sqes[index];
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+	sqe->fd = file_fd;
+	sqe->off = off;
+	sqe->addr = (uint64_t)(uintptr_t)(buffers + slot * AVS_CHUNK_SIZE);
+	sqe->len = AVS_CHUNK_SIZE;
+	sqe->buf_index = fixed ? slot : 0;
+	sqe->user_data = slot;
+
+	sq_array[index] = index;
+	__atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+	slots[slot].busy = true;
+	slots[slot].done = false;
+	to_submit++;
+}
+
+// Submits queued reads and waits for at least @min_complete completions.
+int trace_reader_uring::enter(unsigned int min_complete)
+{
+	unsigned int flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+	int ret;
+
+	do {
+		ret = io_uring_enter(ring_fd, to_submit, min_complete, flags);
+	} while (ret < 0 && errno == EINTR);
+
+	if (ret < 0)
+		return -errno;
+	to_submit -= std::min((unsigned int)ret, to_submit);
+	return 0;
+}
+
+void trace_reader_uring::reap()
+{
+	unsigned int h = *cq_head;
+
+	while (h != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+		struct io_uring_cqe *cqe = &cqes[h & *cq_mask];
+		struct read_slot *slot = &slots[cqe->user_data];
+
+		slot->res = cqe->res;
+		slot->busy = false;
+		slot->done = true;
+		h++;
+	}
+
+	__atomic_store_n(cq_head, h, __ATOMIC_RELEASE);
+}
+
+// Waits for the read of @slot, if in flight.
+int trace_reader_uring::wait(unsigned int slot)
+{
+	int ret;
+
+	while (slots[slot].busy) {
+		ret = enter(1);
+		if (ret)
+			return ret;
+		reap();
+	}
+
+	return 0;
+}
+
+// Queues reads of the chunks following those queued already, up to depth.
+int trace_reader_uring::fill()
+{
+	int ret;
+
+	while (queued < depth) {
+		unsigned int slot = (head + queued) % AVS_URING_DEPTH;
+
+		// dropped from the queue while in flight, its result is stale
+		ret = wait(slot);
+		if (ret)
+			return ret;
+
+		submit(slot, offset + (uint64_t)queued * AVS_CHUNK_SIZE);
+		queued++;
+	}
+
+	return 0;
+}
+
+// Waits for all reads in flight and discards their results.
+int trace_reader_uring::drain()
+{
+	int ret = 0;
+
+	for (unsigned int i = 0; i < AVS_URING_DEPTH; i++) {
+		ret = wait(i);
+		if (ret)
+			return ret;
+		slots[i].done = false;
+	}
+
+	queued = 0;
+	return ret;
+}
+
+int trace_reader_uring::next(const char **data, size_t *len)
+{
+	struct read_slot *slot;
+	int ret;
+
+	*data = buffers;
+	*len = 0;
+
+	if (eof) {
+		eof = false;
+		return 0;
+	}
+
+	// slot returned by previous call, if any, is free to be reused
+	ret = fill();
+	if (ret)
+		return ret;
+
+	slot = &slots[head];
+	ret = wait(head);
+	if (ret)
+		return ret;
+	if (to_submit) {
+		ret = enter(0);
+		if (ret)
+			return ret;
+	}
+
+	slot->done = false;
+	if (slot->res < 0) {
+		ret = slot->res;
+		drain();
+		return ret;
+	}
+
+	*data = buffers + head * AVS_CHUNK_SIZE;
+	*len = slot->res;
+	offset += slot->res;
+	head = (head + 1) % AVS_URING_DEPTH;
+	queued--;
+
+	if (*len == AVS_CHUNK_SIZE) {
+		depth = AVS_URING_DEPTH;
+	} else {
+		/*
+		 * Reads queued past the end of file may have caught data
+		 * appended in the meantime, while the short one did not - drop
+		 * them all. Till the file grows by a chunk, a single read from
+		 * the new offset is all that is queued.
+		 */
+		queued = 0;
+		depth = 1;
+		if (*len)
+			eof = true; // report the end with the next call
+	}
+
+	return 0;
+}
+
+void trace_reader_uring::seek(uint64_t off)
+{
+	// reads in flight are for the old offset
+	queued = 0;
+	eof = false;
+	offset = off;
+}
+
+#endif
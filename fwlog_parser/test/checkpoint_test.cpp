@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <boost/filesystem/operations.hpp>
+#include <cerrno>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "checkpoint.hpp"
+#include "pipeline.hpp"
+#include "test.hpp"
+
+#define SITE_COUNT	16
+
+static std::vector<detailed_path> paths;
+
+/*
+ * Follows @bin from @cp on, as a resumed run does, appending text to
+ * @outpath, till that much text is there. Returns the checkpoint saved
+ * once following ends.
+ */
+static struct checkpoint follow(const std::string &bin, const std::string &outpath,
+				const std::string &ckpath, const struct checkpoint &cp,
+				uint64_t text_size)
+{
+	dictionary<struct log_literal1_5> *dict = new dictionary<struct log_literal1_5>();
+	dictionary_slot<struct log_literal1_5> slot(dict);
+	std::unique_ptr<itrace_reader> reader = open_trace_reader(bin);
+	checkpointer ckpt(ckpath, bin, cp);
+	std::ofstream out(outpath, std::ios::binary | std::ios::app);
+	struct checkpoint saved = {};
+	boost::system::error_code ec;
+
+	build_dictionary(*dict, paths);
+	reader->seek(cp.offset);
+
+	follow_pipeline<log_entry_spt> pipeline(*reader, bin, &out, slot, nullptr, nullptr,
+						&ckpt);
+	std::thread runner(&follow_pipeline<log_entry_spt>::run, &pipeline);
+
+	for (int i = 0; i < 1000; i++) {
+		if (boost::filesystem::file_size(outpath, ec) >= text_size)
+			break;
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	pipeline.finish();
+	runner.join();
+	out.close();
+
+	CHECK(load_checkpoint(ckpath, saved) == 0);
+	CHECK(saved.dictionary == dictionary_fingerprint(*slot.get()));
+	return saved;
+}
+
+int main()
+{
+	std::string csv = test_path("sites.csv");
+	std::string bin = test_path("trace.bin");
+	std::string outpath = test_path("out.txt");
+	std::string ckpath = test_path("checkpoint");
+	struct checkpoint cp = {};
+	uint64_t timestamp = 1000, identity;
+	std::string trace;
+	size_t boundary;
+
+	test_write(csv, spt_sites(SITE_COUNT, "site"));
+	paths.push_back(detailed_path(csv, 0));
+
+	spt_records(trace, 20000, SITE_COUNT, 0, timestamp);
+	for (uint32_t i = 0; i < 50; i++)
+		spt_record(trace, SITE_COUNT + 1 + i % 7, 10, 1, 0, 0, timestamp, i);
+	spt_records(trace, 10000, SITE_COUNT, 0, timestamp);
+	boundary = trace.size();
+	spt_records(trace, 10000, SITE_COUNT, 0, timestamp);
+
+	// first run sees the trace cut in the middle of a record
+	test_write(bin, trace.substr(0, boundary));
+	std::string first = spt_decode(bin, paths);
+	test_write(bin, trace.substr(0, boundary + 6));
+	test_write(outpath, "");
+
+	cp = follow(bin, outpath, ckpath, cp, first.size());
+	CHECK(cp.output == first.size());
+	CHECK(cp.offset == boundary);
+	CHECK(trace_identity(bin, cp.offset, identity) == 0 && identity == cp.identity);
+
+	// text written past the checkpoint gets dropped, as resuming does
+	test_write(outpath, first + "lost text\n");
+	boost::filesystem::resize_file(outpath, cp.output);
+
+	test_write(bin, trace);
+	std::string expected = spt_decode(bin, paths);
+
+	cp = follow(bin, outpath, ckpath, cp, expected.size());
+	CHECK(cp.offset == trace.size());
+
+	std::ifstream file(outpath, std::ios::binary);
+	std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	CHECK(expected.find("Unknown record") != std::string::npos);
+	CHECK(text == expected);
+
+	// trace rewritten before the checkpoint is not resumed from
+	trace[cp.offset - 8] ^= 0xff;
+	test_write(bin, trace);
+	CHECK(trace_identity(bin, cp.offset, identity) == 0 && identity != cp.identity);
+
+	boost::filesystem::remove(csv);
+	boost::filesystem::remove(bin);
+	boost::filesystem::remove(outpath);
+	boost::filesystem::remove(ckpath);
+	return test_exit("checkpoint_test");
+}
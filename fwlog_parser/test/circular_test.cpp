@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <boost/filesystem/operations.hpp>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "circular_dump.hpp"
+#include "test.hpp"
+
+#define SITE_COUNT	16
+
+static std::vector<detailed_path> paths;
+static std::string trace;
+static std::vector<size_t> offsets; // of each record of the trace
+
+/*
+ * Dumps a window of @size bytes the whole trace was logged into, decodes
+ * it in chronological order and compares that with the records the
+ * window is expected to hold.
+ */
+static void check_window(size_t size)
+{
+	std::string dump = test_path("dump.bin");
+	std::string bin = test_path("trace.bin");
+	std::string window(size, '\0');
+	struct circular_window win;
+	size_t first = 0, last = offsets.size();
+	std::ostringstream out;
+
+	for (size_t pos = trace.size() - size; pos < trace.size(); pos++)
+		window[pos % size] = trace[pos];
+	test_write(dump, window);
+
+	// oldest entry in full and, unless it straddles the end, the newest
+	while (offsets[first] < trace.size() - size)
+		first++;
+	if (offsets.back() % size > (trace.size() - 1) % size)
+		last--;
+	test_write(bin, trace.substr(offsets[first],
+				     (last < offsets.size() ? offsets[last] : trace.size()) -
+				     offsets[first]));
+
+	{
+		dictionary<struct log_literal1_5> *dict = new dictionary<struct log_literal1_5>();
+		dictionary_slot<struct log_literal1_5> slot(dict);
+		std::unique_ptr<itrace_reader> reader = open_trace_reader(dump);
+
+		build_dictionary(*dict, paths);
+		CHECK(find_wrap<log_entry_spt>(*reader, *dict, win) == 0);
+		CHECK(win.size == size);
+		CHECK(win.begin == offsets[first] % size);
+
+		circular_reader circular(std::move(reader), win);
+
+		CHECK(process_logdump<log_entry_spt>(circular, out, slot) == 0);
+	}
+
+	std::string expected = spt_decode(bin, paths);
+
+	CHECK(!expected.empty());
+	CHECK(out.str() == expected);
+
+	boost::filesystem::remove(dump);
+	boost::filesystem::remove(bin);
+}
+
+int main()
+{
+	std::string csv = test_path("sites.csv");
+	uint64_t timestamp = 1000;
+
+	test_write(csv, spt_sites(SITE_COUNT, "site"));
+	paths.push_back(detailed_path(csv, 0));
+
+	for (uint32_t i = 0; i < 30000; i++) {
+		uint32_t site = i % SITE_COUNT + 1;
+
+		offsets.push_back(trace.size());
+		spt_record(trace, site, 10 * site, (site - 1) % 4 + 1, i % 4, 0, timestamp, i);
+		timestamp += 7;
+	}
+
+	// oldest entry partly overwritten, window wrapping several chunks in
+	check_window(3 * AVS_CHUNK_SIZE / 2 + 12);
+	check_window(offsets[5000] - offsets[1000] + 8);
+	// window begins at an entry
+	check_window(trace.size() - offsets[7777]);
+	// newest entry straddles the end of the window
+	check_window(offsets.back() + sizeof(uint32_t));
+
+	boost::filesystem::remove(csv);
+	return test_exit("circular_test");
+}
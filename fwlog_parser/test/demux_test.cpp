@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <boost/filesystem/operations.hpp>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+#include "demux.hpp"
+#include "test.hpp"
+
+#define SITE_COUNT	16
+// more streams than files kept open, so some get reopened for appending
+#define INSTANCE_COUNT	(AVS_DEMUX_MAX_OPEN + 16)
+
+static std::string test_read(const std::string &path)
+{
+	std::ifstream file(path, std::ios::binary);
+
+	return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// Appends records of instances cycling through INSTANCE_COUNT of them.
+static void add_records(std::string &trace, uint32_t count, uint64_t &timestamp)
+{
+	for (uint32_t i = 0; i < count; i++) {
+		uint16_t instance = (uint16_t)(i * 13 % INSTANCE_COUNT);
+		size_t pos = trace.size();
+
+		spt_records(trace, 1, SITE_COUNT, 0, timestamp);
+		trace.replace(pos + sizeof(uint32_t), sizeof(instance), (const char *)&instance,
+			      sizeof(instance));
+	}
+}
+
+int main()
+{
+	std::string csv = test_path("sites.csv");
+	std::string bin = test_path("trace.bin");
+	std::string prefix = test_path("demux");
+	std::vector<detailed_path> paths;
+	std::string trace;
+	uint64_t timestamp = 1000;
+
+	test_write(csv, spt_sites(SITE_COUNT, "site"));
+	paths.push_back(detailed_path(csv, 0));
+
+	// several chunks of trace, text of each stream written out more than once
+	add_records(trace, 40000, timestamp);
+	for (uint32_t i = 0; i < 50; i++)
+		spt_record(trace, SITE_COUNT + 1 + i % 7, 10, 1, 0, 0, timestamp, i);
+	add_records(trace, 40000, timestamp);
+	test_write(bin, trace);
+
+	std::string expected = spt_decode(bin, paths);
+
+	{
+		dictionary<struct log_literal1_5> *dict = new dictionary<struct log_literal1_5>();
+		dictionary_slot<struct log_literal1_5> slot(dict);
+		std::unique_ptr<itrace_reader> reader = open_trace_reader(bin);
+		demux_writer writer(prefix, DEMUX_MODULE);
+
+		build_dictionary(*dict, paths);
+		CHECK(trace.size() > 2 * AVS_CHUNK_SIZE);
+		CHECK(demux_logdump<log_entry_spt>(*reader, slot, writer, DEMUX_MODULE) == 0);
+		writer.close();
+		CHECK(writer.streams() == INSTANCE_COUNT + 1);
+	}
+
+	// each stream holds its lines of the whole text, in order
+	for (int i = 0; i < INSTANCE_COUNT; i++) {
+		std::string path = prefix + ".module5_" + std::to_string(i);
+		std::string lines = test_lines(expected, " 5," + std::to_string(i) + " ");
+
+		CHECK(!lines.empty());
+		CHECK(test_read(path) == lines);
+		boost::filesystem::remove(path);
+	}
+	CHECK(test_read(prefix + ".unknown") == test_lines(expected, "Unknown record"));
+	CHECK(!test_lines(expected, "Unknown record").empty());
+
+	boost::filesystem::remove(prefix + ".unknown");
+	boost::filesystem::remove(csv);
+	boost::filesystem::remove(bin);
+	return test_exit("demux_test");
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <boost/filesystem/operations.hpp>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "extract.hpp"
+#include "test.hpp"
+
+#define SITE_COUNT	8
+// logged at ERROR level
+#define ERROR_SITE	3
+
+static std::vector<detailed_path> paths;
+static std::string bin;
+
+/*
+ * Extracts entries selected by @sel and @levels into a trace of their own
+ * and returns its text, decoded again.
+ */
+static std::string extract(const struct index_selection &sel,
+			   const std::vector<std::string> &levels, struct extract_stats &stats)
+{
+	std::string extracted = test_path("extracted.bin");
+	std::string text;
+
+	{
+		dictionary<struct log_literal1_5> *dict = new dictionary<struct log_literal1_5>();
+		dictionary_slot<struct log_literal1_5> slot(dict);
+		std::unique_ptr<itrace_reader> reader = open_trace_reader(bin);
+		record_filter<log_entry_spt> filter(sel, levels);
+		std::ofstream out(extracted, std::ios::binary | std::ios::trunc);
+
+		build_dictionary(*dict, paths);
+		CHECK(extract_logdump<log_entry_spt>(*reader, out, slot, filter, stats) == 0);
+	}
+
+	text = spt_decode(extracted, paths);
+	CHECK(boost::filesystem::file_size(extracted) == stats.kept_bytes);
+	boost::filesystem::remove(extracted);
+	return text;
+}
+
+/*
+ * Appends @size bytes of DWORDs none of which frames a known entry, their
+ * file_id being beyond those of the dictionary.
+ */
+static size_t add_garbage(std::string &trace, size_t size, uint32_t &seed)
+{
+	for (size_t i = 0; i < size / sizeof(uint32_t); i++) {
+		uint32_t dw;
+
+		seed = seed * 1103515245 + 12345;
+		dw = (seed & ~(0x1fffu << 16)) | (SITE_COUNT + 1 + (seed >> 20) % 1000) << 16;
+		trace.append((const char *)&dw, sizeof(dw));
+	}
+
+	return size / sizeof(uint32_t) * sizeof(uint32_t);
+}
+
+int main()
+{
+	std::string csv0 = test_path("lib0.csv");
+	std::string csv1 = test_path("lib1.csv");
+	std::string sites = spt_sites(SITE_COUNT, "lib1 site");
+	std::vector<std::string> levels;
+	struct index_selection sel;
+	struct extract_stats stats;
+	uint64_t timestamp = 1000, key;
+	uint32_t seed = 1;
+	size_t garbage = 0;
+	std::string trace;
+
+	bin = test_path("trace.bin");
+	sites.replace(sites.find("INFO", sites.find("file" + std::to_string(ERROR_SITE) + ".c")),
+		      4, "ERROR");
+	test_write(csv0, spt_sites(SITE_COUNT, "lib0 site"));
+	test_write(csv1, sites);
+	paths.push_back(detailed_path(csv0, 0));
+	paths.push_back(detailed_path(csv1, 1));
+
+	garbage += add_garbage(trace, 100, seed);
+	for (uint32_t i = 0; i < 8; i++) {
+		spt_records(trace, 5000, SITE_COUNT, i % 2, timestamp);
+		garbage += add_garbage(trace, 4 + i * 1000, seed);
+	}
+	// incomplete entry at the very end
+	trace.append("\x01\x02\x03", 3);
+	garbage += 3;
+	test_write(bin, trace);
+
+	std::string expected = spt_decode(bin, paths);
+
+	// all known entries, unknown data dropped as a whole
+	CHECK(extract(sel, levels, stats) == test_lines(expected, " site "));
+	CHECK(stats.entries == 40000 && stats.kept == stats.entries);
+	CHECK(stats.dropped_bytes == garbage);
+	CHECK(stats.kept_bytes + stats.dropped_bytes == trace.size());
+
+	sel.libs = { 1 };
+	sel.cores = { 0, 2 };
+	levels.push_back("ERROR");
+	CHECK(extract(sel, levels, stats) ==
+	      spt_filter_lines(expected, [](uint64_t t, uint32_t c, uint32_t l, uint32_t s) {
+		return l == 1 && (c == 0 || c == 2) && s == ERROR_SITE;
+	}));
+	CHECK(stats.kept && stats.dropped_bytes == garbage);
+
+	sel = index_selection();
+	levels.clear();
+	sel.from = 50000;
+	sel.to = 200000;
+	CHECK(log_entry_spt::parse_key("5:50", key));
+	sel.sites.push_back(std::make_pair(0u, key));
+	CHECK(log_entry_spt::parse_key("7:70", key));
+	sel.sites.push_back(std::make_pair(1u, key));
+	CHECK(extract(sel, levels, stats) ==
+	      spt_filter_lines(expected, [](uint64_t t, uint32_t c, uint32_t l, uint32_t s) {
+		return t >= 50000 && t <= 200000 && ((!l && s == 5) || (l && s == 7));
+	}));
+	CHECK(stats.kept && stats.dropped_bytes == garbage);
+
+	boost::filesystem::remove(csv0);
+	boost::filesystem::remove(csv1);
+	boost::filesystem::remove(bin);
+	return test_exit("extract_test");
+}
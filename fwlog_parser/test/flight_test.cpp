@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <boost/filesystem/operations.hpp>
+#include <deque>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "flight_recorder.hpp"
+#include "test.hpp"
+
+#define SITE_COUNT	8
+// logged at ERROR level
+#define ERROR_SITE	6
+#define TRIGGER_SITE	8
+
+struct known_record {
+	uint64_t position;
+	uint64_t timestamp;
+	uint32_t site;
+	std::string line;
+};
+
+static std::vector<detailed_path> paths;
+static std::vector<struct known_record> records;
+static std::string bin;
+
+static std::string record(const struct flight_spec &spec)
+{
+	dictionary<struct log_literal1_5> *dict = new dictionary<struct log_literal1_5>();
+	dictionary_slot<struct log_literal1_5> slot(dict);
+	std::unique_ptr<itrace_reader> reader = open_trace_reader(bin);
+	flight_recorder<log_entry_spt> recorder(spec);
+	std::ostringstream out;
+
+	build_dictionary(*dict, paths);
+	CHECK(flight_logdump<log_entry_spt>(*reader, out, slot, recorder) == 0);
+	return out.str();
+}
+
+// Replays known records the way the recorder is described to.
+static std::string reference(const struct flight_spec &spec, bool by_level)
+{
+	std::deque<const struct known_record *> window;
+	uint64_t after_left = 0;
+	std::string out;
+
+	for (auto it = records.begin(); it != records.end(); it++) {
+		bool trigger = it->site == TRIGGER_SITE || (by_level && it->site == ERROR_SITE);
+
+		if (trigger) {
+			if (!after_left) {
+				out += "Trigger at position: " + std::to_string(it->position) +
+				       "\n";
+				for (; !window.empty(); window.pop_front())
+					if (spec.before ||
+					    window.front()->timestamp + spec.span >= it->timestamp)
+						out += window.front()->line;
+			}
+			after_left = spec.after + 1;
+		}
+
+		if (after_left) {
+			out += it->line;
+			after_left--;
+			continue;
+		}
+
+		if (!spec.before)
+			while (!window.empty() &&
+			       window.front()->timestamp + spec.span < it->timestamp)
+				window.pop_front();
+		window.push_back(&*it);
+		if (spec.before && window.size() > spec.before)
+			window.pop_front();
+	}
+
+	return out;
+}
+
+int main()
+{
+	std::string csv = test_path("sites.csv");
+	std::string sites = spt_sites(SITE_COUNT, "site");
+	std::string trace, expected;
+	struct flight_spec spec;
+	uint64_t timestamp = 1000;
+	uint32_t seed = 1;
+
+	bin = test_path("trace.bin");
+	sites.replace(sites.find("INFO", sites.find("file" + std::to_string(ERROR_SITE) + ".c")),
+		      4, "ERROR");
+	test_write(csv, sites);
+	paths.push_back(detailed_path(csv, 0));
+
+	for (uint32_t i = 0; i < 40000; i++) {
+		struct known_record r;
+
+		seed = seed * 1103515245 + 12345;
+		r.site = i % (SITE_COUNT - 3) + 1;
+		// triggers now and then, some of them close to each other
+		if ((seed >> 16) % 1500 == 0 || i % 7919 == 3 || i % 7919 == 40)
+			r.site = TRIGGER_SITE;
+		if ((seed >> 16) % 3000 == 1)
+			r.site = ERROR_SITE;
+		if (i % 4000 == 17)
+			// unknown to the dictionary, never recorded
+			spt_record(trace, SITE_COUNT + 1, 10, 1, 0, 0, timestamp, i);
+
+		r.position = trace.size();
+		r.timestamp = timestamp;
+		spt_record(trace, r.site, 10 * r.site, (r.site - 1) % 4 + 1, i % 4, 0, timestamp,
+			   i);
+		records.push_back(r);
+		timestamp += (seed >> 8) % 40;
+	}
+	test_write(bin, trace);
+
+	// plain decode gives text of each known record
+	std::istringstream lines(test_lines(spt_decode(bin, paths), " site "));
+	std::string line;
+
+	for (auto it = records.begin(); std::getline(lines, line) && it != records.end(); it++)
+		it->line = line + "\n";
+	CHECK(!lines && records.back().line.size());
+
+	spec.before = 50;
+	spec.span = 0;
+	spec.after = 20;
+	spec.sites.push_back(std::make_pair(0u, (uint64_t)0));
+	CHECK(log_entry_spt::parse_key(std::to_string(TRIGGER_SITE) + ":" +
+				       std::to_string(10 * TRIGGER_SITE), spec.sites[0].second));
+	expected = reference(spec, false);
+	CHECK(expected.find("Trigger at position") != std::string::npos);
+	CHECK(record(spec) == expected);
+
+	// window spanning time, growing past its initial capacity
+	spec.before = 0;
+	spec.span = 60000;
+	spec.after = AVS_FLIGHT_AFTER;
+	spec.levels.push_back("ERROR");
+	expected = reference(spec, true);
+	CHECK(expected.size() > 2 * AVS_FLIGHT_MIN_RECORDS * records.back().line.size());
+	CHECK(record(spec) == expected);
+
+	boost::filesystem::remove(csv);
+	boost::filesystem::remove(bin);
+	return test_exit("flight_test");
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <boost/filesystem/operations.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "dictionary.hpp"
+#include "grep.hpp"
+#include "log_entry_spt.hpp"
+#include "test.hpp"
+
+typedef struct log_literal1_5 literal_type;
+
+// Returns the number of records of @trace whose text matches @pattern.
+static size_t grep_count(std::string trace, const dictionary<literal_type> &dict,
+			 const std::string &pattern)
+{
+	grep_filter<literal_type> filter(pattern);
+	std::ostringstream out;
+	std::string text;
+	size_t consumed, count = 0;
+
+	trace.append(log_entry_spt::max_size(), '\0');
+	CHECK(grep_block<log_entry_spt>(&trace[0], trace.size() - log_entry_spt::max_size(),
+					out, dict, filter, consumed) == 0);
+
+	std::istringstream in(out.str());
+	while (std::getline(in, text))
+		count++;
+	return count;
+}
+
+int main()
+{
+	std::string csv = test_path("sites.csv");
+	std::vector<detailed_path> paths;
+	dictionary<literal_type> dict;
+	std::string trace;
+
+	test_write(csv, "7,3,\"fid7.c\",\"prov\",\"INFO\",\"fid7 ln3\",p1,p2,p3,p4\n"
+			"7,4,\"fid7.c\",\"prov\",\"INFO\",\"fid7 ln3 and more %u\",p1,p2,p3,p4\n");
+	paths.push_back(detailed_path(csv, 0));
+	build_dictionary(dict, paths);
+	boost::filesystem::remove(csv);
+
+	for (int i = 0; i < 10; i++) {
+		spt_record(trace, 7, 3, 1, 0, 0, 100 + i, i);
+		spt_record(trace, 7, 4, 1, 0, 0, 200 + i, i);
+	}
+
+	// anchors apply to the text of the record, without its newline
+	CHECK(grep_count(trace, dict, "fid7 ln3") == 20);
+	CHECK(grep_count(trace, dict, "fid7 ln3$") == 10);
+	CHECK(grep_count(trace, dict, "more [0-9]+$") == 10);
+	CHECK(grep_count(trace, dict, "^1[0-9]+: 0 ") == 10);
+
+	// and to each line of records spanning more than one
+	grep_filter<literal_type> filter("^icl msg 1$");
+
+	CHECK(filter.matches("5031: src/icl0.c(100):\nicl msg 1\n"));
+	CHECK(!filter.matches("5031: src/icl0.c(100):\nicl msg 10\n"));
+	CHECK(grep_filter<literal_type>("\\(100\\):$")
+		.matches("5031: src/icl0.c(100):\nicl msg 1\n"));
+
+	return test_exit("grep_test");
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <boost/filesystem/operations.hpp>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "trace_index.hpp"
+#include "test.hpp"
+
+#define SITE_COUNT	8
+
+static std::vector<detailed_path> paths;
+static std::string bin;
+
+static std::string query(const trace_index &index, const struct index_selection &sel,
+			 const dictionary<struct log_literal1_5> &dict)
+{
+	std::ifstream trace(bin, std::ios::binary);
+	std::vector<uint32_t> rows;
+	std::ostringstream out;
+	uint64_t read;
+
+	index.select(sel, rows);
+	CHECK(query_index<log_entry_spt>(trace, index, rows, out, dict, read) == 0);
+	return out.str();
+}
+
+static std::pair<uint32_t, uint64_t> site(uint32_t lib, const std::string &key)
+{
+	uint64_t k = 0;
+
+	CHECK(log_entry_spt::parse_key(key, k));
+	return std::make_pair(lib, (uint64_t)log_entry_spt::pack_key(k));
+}
+
+int main()
+{
+	std::string csv0 = test_path("lib0.csv");
+	std::string csv1 = test_path("lib1.csv");
+	std::string idx = test_path("trace.idx");
+	dictionary<struct log_literal1_5> dict;
+	struct index_identity id = {}, loaded;
+	struct index_selection sel;
+	trace_index index, copy;
+	uint64_t timestamp = 1000;
+	std::string trace;
+
+	bin = test_path("trace.bin");
+	test_write(csv0, spt_sites(SITE_COUNT, "lib0 site"));
+	test_write(csv1, spt_sites(SITE_COUNT, "lib1 site"));
+	paths.push_back(detailed_path(csv0, 0));
+	paths.push_back(detailed_path(csv1, 1));
+	build_dictionary(dict, paths);
+
+	spt_records(trace, 20000, SITE_COUNT, 0, timestamp);
+	for (uint32_t i = 0; i < 50; i++)
+		spt_record(trace, SITE_COUNT + 1 + i % 7, 10, 1, 0, 1, timestamp, i);
+	spt_records(trace, 20000, SITE_COUNT, 1, timestamp);
+	spt_records(trace, 20000, SITE_COUNT, 0, timestamp);
+	test_write(bin, trace);
+
+	std::string expected = spt_decode(bin, paths);
+
+	{
+		std::unique_ptr<itrace_reader> reader = open_trace_reader(bin);
+
+		CHECK(build_index<log_entry_spt>(*reader, dict, index) == 0);
+		CHECK(index.size() == 60000);
+	}
+
+	// index holds known entries only, in trace order
+	CHECK(query(index, sel, dict) == test_lines(expected, " site "));
+
+	sel.cores = { 1, 3 };
+	CHECK(query(index, sel, dict) ==
+	      spt_filter_lines(expected, [](uint64_t t, uint32_t c, uint32_t l, uint32_t s) {
+		return c == 1 || c == 3;
+	}));
+
+	sel = index_selection();
+	sel.libs = { 1 };
+	sel.sites = { site(1, "3:30"), site(0, "5:50"), site(0, "4:41") };
+	CHECK(query(index, sel, dict) ==
+	      spt_filter_lines(expected, [](uint64_t t, uint32_t c, uint32_t l, uint32_t s) {
+		return l == 1 && s == 3;
+	}));
+
+	sel = index_selection();
+	sel.from = 100000;
+	sel.to = 300000;
+	sel.sites = { site(0, "2:20"), site(1, "7:70") };
+	CHECK(query(index, sel, dict) ==
+	      spt_filter_lines(expected, [](uint64_t t, uint32_t c, uint32_t l, uint32_t s) {
+		return t >= 100000 && t <= 300000 && ((!l && s == 2) || (l && s == 7));
+	}));
+
+	// saved index answers the same
+	id.trace_size = trace.size();
+	CHECK(index.save(idx, id) == 0);
+	CHECK(copy.load(idx, loaded) == 0);
+	CHECK(loaded.trace_size == id.trace_size);
+	CHECK(query(copy, sel, dict) == query(index, sel, dict));
+
+	// offsets past 4 GiB keep their high bits
+	trace_index big;
+	uint64_t offsets[] = { 16, 0xfffffff0ULL, 0x100000004ULL, 0x100000008ULL,
+			       0x3000000a0ULL };
+
+	for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++)
+		big.add(offsets[i], i, 0, 0, 20, 0);
+	CHECK(big.save(idx, id) == 0 && big.load(idx, loaded) == 0);
+	for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++)
+		CHECK(big.offset(i) == offsets[i]);
+
+	boost::filesystem::remove(csv0);
+	boost::filesystem::remove(csv1);
+	boost::filesystem::remove(bin);
+	boost::filesystem::remove(idx);
+	return test_exit("index_test");
+}
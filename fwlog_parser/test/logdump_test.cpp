@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <boost/filesystem/operations.hpp>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "dictionary.hpp"
+#include "log_entry_spt.hpp"
+#include "logdump.hpp"
+#include "trace_reader.hpp"
+#include "test.hpp"
+
+#define SITE_COUNT	16
+
+// Decodes one record at a time, as the parser did before decoding in batches.
+static std::string decode_serial(std::string trace, const dictionary<struct log_literal1_5> &dict)
+{
+	std::ostringstream out;
+	log_entry_spt entry;
+	size_t pos = 0;
+
+	// formatters may access payload beyond the entry
+	trace.append(log_entry_spt::max_size(), '\0');
+	while (pos + log_entry_spt::hdr_size() <= trace.size() - log_entry_spt::max_size()) {
+		size_t size = log_entry_spt::size((unsigned char)trace[pos]);
+		const struct log_literal1_5 *literal;
+
+		if (pos + size > trace.size() - log_entry_spt::max_size())
+			break;
+
+		entry.assign_ptr(&trace[pos]);
+		if (!entry.is_valid()) {
+			pos += sizeof(uint32_t);
+			continue;
+		}
+
+		literal = dict.find(entry.lib_id(), entry.key());
+		if (!literal) {
+			out << "Unknown record at position: " << pos << "\n";
+			pos += sizeof(uint32_t);
+			continue;
+		}
+
+		write_entry(out, dict.strings(), literal, entry,
+			    (uint32_t *)&trace[pos + log_entry_spt::hdr_size()]);
+		pos += size;
+	}
+
+	return out.str();
+}
+
+static std::string decode(const std::string &path, dictionary<struct log_literal1_5> *dict)
+{
+	dictionary_slot<struct log_literal1_5> slot(dict);
+	std::unique_ptr<itrace_reader> reader = open_trace_reader(path);
+	std::ostringstream out;
+
+	CHECK(process_logdump<log_entry_spt>(*reader, out, slot) == 0);
+	return out.str();
+}
+
+static void add_records(std::string &trace, uint32_t count, uint64_t &timestamp)
+{
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t site = i % SITE_COUNT;
+
+		spt_record(trace, site + 1, 10 * (site + 1), site % 4 + 1, i % 4, 0, timestamp, i);
+		timestamp += 7;
+	}
+}
+
+/*
+ * Garbage run mixes random DWORDs with headers of unknown sites, so both
+ * invalid and unknown entries get skipped, and ends mid-chunk.
+ */
+static void add_garbage(std::string &trace, size_t size)
+{
+	uint32_t seed = 1;
+
+	for (size_t i = 0; i < size / sizeof(uint32_t); i++) {
+		uint32_t dw;
+
+		seed = seed * 1103515245 + 12345;
+		dw = seed;
+		if (i % 5 == 0)
+			// file_id beyond those of the dictionary
+			dw = (dw & ~(0x1fffu << 16)) | (SITE_COUNT + 1 + (seed >> 20) % 64) << 16;
+		trace.append((const char *)&dw, sizeof(dw));
+	}
+}
+
+int main()
+{
+	std::string csv = test_path("sites.csv");
+	std::string bin = test_path("garbage.bin");
+	std::vector<detailed_path> paths;
+	std::string trace, csvdata;
+	uint64_t timestamp = 1000;
+
+	for (int i = 0; i < SITE_COUNT; i++) {
+		std::string message = "site " + std::to_string(i + 1);
+
+		for (int j = 0; j < i % 4 + 1; j++)
+			message += " %u";
+		csvdata += std::to_string(i + 1) + "," + std::to_string(10 * (i + 1)) + ",\"file" +
+			   std::to_string(i + 1) + ".c\",\"prov\",\"INFO\",\"" + message +
+			   "\",p1,p2,p3,p4\n";
+	}
+	test_write(csv, csvdata);
+	paths.push_back(detailed_path(csv, 0));
+
+	add_records(trace, 20000, timestamp);
+	add_garbage(trace, 400000);
+	add_records(trace, 20000, timestamp);
+	// incomplete record at the very end is left undecoded
+	trace.append(4, '\x01');
+	test_write(bin, trace);
+
+	dictionary<struct log_literal1_5> *dict = new dictionary<struct log_literal1_5>();
+
+	build_dictionary(*dict, paths);
+	std::string expected = decode_serial(trace, *dict);
+	// slot of the decoder takes the dictionary over
+	std::string decoded = decode(bin, dict);
+
+	CHECK(expected.find("Unknown record") != std::string::npos);
+	CHECK(decoded == expected);
+
+	boost::filesystem::remove(csv);
+	boost::filesystem::remove(bin);
+	return test_exit("logdump_test");
+}
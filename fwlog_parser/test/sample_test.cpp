@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <boost/filesystem/operations.hpp>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "sample.hpp"
+#include "trace_reader_stream.hpp"
+#include "test.hpp"
+
+#define SITE_COUNT	16
+
+static std::vector<detailed_path> paths;
+
+static bool parses(const std::string &spec)
+{
+	try {
+		parse_sample(spec);
+		return true;
+	} catch (const std::invalid_argument &e) {
+		return false;
+	}
+}
+
+// Returns text sampled out of the trace at @path as given by @spec.
+static std::string sample(const std::string &path, const std::string &spec)
+{
+	dictionary<struct log_literal1_5> *dict = new dictionary<struct log_literal1_5>();
+	dictionary_slot<struct log_literal1_5> slot(dict);
+	struct sample_spec s = parse_sample(spec);
+	trace_reader_stream reader;
+	std::ostringstream out;
+
+	build_dictionary(*dict, paths);
+	CHECK(reader.open(path) == 0);
+	if (s.mode == SAMPLE_BLOCKS)
+		CHECK(sample_blocks<log_entry_spt>(reader, boost::filesystem::file_size(path),
+						   out, slot, s) == 0);
+	else
+		CHECK(sample_logdump<log_entry_spt>(reader, out, slot, s) == 0);
+	return out.str();
+}
+
+// Returns every @n-th line of @text.
+static std::string every_line(const std::string &text, size_t n)
+{
+	std::istringstream in(text);
+	std::string line, result;
+
+	for (size_t i = 0; std::getline(in, line); i++)
+		if (i % n == 0)
+			result += line + "\n";
+	return result;
+}
+
+// Checks each burst of @text is a run of lines of @expected.
+static size_t check_bursts(const std::string &text, const std::string &expected)
+{
+	const std::string header = "Sample at position: ";
+	size_t pos = 0, bursts = 0;
+
+	while (pos < text.size()) {
+		size_t eol = text.find('\n', pos);
+		size_t end = text.find(header, eol);
+		std::string burst;
+
+		CHECK(!text.compare(pos, header.size(), header));
+		if (end == std::string::npos)
+			end = text.size();
+		burst = text.substr(eol + 1, end - eol - 1);
+
+		size_t at = expected.find(burst);
+
+		CHECK(!burst.empty() && at != std::string::npos &&
+		      (!at || expected[at - 1] == '\n'));
+		pos = end;
+		bursts++;
+	}
+
+	return bursts;
+}
+
+static void check_decode()
+{
+	std::string csv = test_path("sites.csv");
+	std::string bin = test_path("trace.bin");
+	uint64_t timestamp = 1000;
+	std::string trace;
+
+	test_write(csv, spt_sites(SITE_COUNT, "site"));
+	paths.push_back(detailed_path(csv, 0));
+
+	spt_records(trace, 15000, SITE_COUNT, 0, timestamp);
+	for (uint32_t i = 0; i < 50; i++)
+		spt_record(trace, SITE_COUNT + 1 + i % 7, 10, 1, 0, 0, timestamp, i);
+	spt_records(trace, 15000, SITE_COUNT, 0, timestamp);
+	test_write(bin, trace);
+
+	std::string expected = spt_decode(bin, paths);
+	std::string known = test_lines(expected, " site ");
+	std::string text;
+
+	// unknown entries are not reported when sampling entries
+	CHECK(sample(bin, "every:1") == known);
+	CHECK(sample(bin, "every:3") == every_line(known, 3));
+	CHECK(sample(bin, "fraction:1") == known);
+
+	text = sample(bin, "fraction:0.1");
+	CHECK(text == sample(bin, "fraction:0.1"));
+	CHECK(text.size() > known.size() / 20 && text.size() < known.size() / 5);
+
+	// bursts back to back decode the whole trace
+	CHECK(trace.size() < 4 * AVS_CHUNK_SIZE);
+	CHECK(sample(bin, "blocks:4:" + std::to_string(AVS_CHUNK_SIZE)) ==
+	      "Sample at position: 0\n" + expected);
+	CHECK(check_bursts(sample(bin, "blocks:16:4096"), expected) == 16);
+
+	boost::filesystem::remove(csv);
+	boost::filesystem::remove(bin);
+}
+
+int main()
+{
+	struct sample_spec s;
+
+	s = parse_sample("blocks:10");
+	CHECK(s.mode == SAMPLE_BLOCKS && s.blocks == 10 && s.burst == AVS_SAMPLE_BURST);
+	s = parse_sample("blocks:10:4096");
+	CHECK(s.blocks == 10 && s.burst == 4096);
+	s = parse_sample("every:3");
+	CHECK(s.mode == SAMPLE_EVERY && s.every == 3);
+	s = parse_sample("fraction:0.5");
+	CHECK(s.mode == SAMPLE_FRACTION && s.fraction == 0.5);
+
+	// a burst is decoded as a single block
+	CHECK(parses("blocks:1:" + std::to_string(AVS_CHUNK_SIZE)));
+	CHECK(!parses("blocks:1:" + std::to_string(AVS_CHUNK_SIZE + 1)));
+	CHECK(!parses("blocks:1:4294967296"));
+	CHECK(!parses("blocks:1:18446744073709551615"));
+	CHECK(!parses("blocks:1:-1"));
+	CHECK(!parses("blocks:1:0"));
+	CHECK(!parses("blocks:0"));
+	CHECK(!parses("every:0"));
+	CHECK(!parses("fraction:1.5"));
+	CHECK(!parses("blocks:1:4k"));
+	CHECK(!parses("random:1"));
+
+	check_decode();
+
+	return test_exit("sample_test");
+}
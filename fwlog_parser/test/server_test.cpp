@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "log_server.hpp"
+#include "test.hpp"
+
+#if defined(AVS_HAVE_LOG_SERVER)
+
+#include <boost/filesystem/operations.hpp>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "string_streambuf.hpp"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define SITE_COUNT	8
+
+static const char probe[] = "probe\n";
+
+// Builds the chunk as the pipeline's decoder does, one record at a time.
+static void decode_chunk(std::string trace, const dictionary<struct log_literal1_5> &dict,
+			 struct text_chunk &chunk)
+{
+	string_streambuf sb;
+	std::ostream out(&sb);
+	size_t consumed, mark = 0;
+
+	auto hook = [&](const char *raw, size_t size, uint32_t lib_id) {
+		struct record_ref r;
+
+		r.text = mark;
+		r.text_len = chunk.text.size() - mark;
+		r.raw = chunk.raw.size();
+		r.raw_len = size;
+		r.lib_id = lib_id;
+		chunk.raw.append(raw, size);
+		chunk.records.push_back(r);
+		mark = chunk.text.size();
+	};
+
+	sb.attach(&chunk.text);
+	trace.append(log_entry_spt::max_size(), '\0');
+	CHECK(decode_block<log_entry_spt>(&trace[0], trace.size() - log_entry_spt::max_size(),
+					  0, out, dict, consumed, hook, nullptr) == 0);
+	chunk.last = false;
+}
+
+// Reads what is available on @fd within @timeout_ms, appending it to @data.
+static bool receive(int fd, std::string &data, int timeout_ms)
+{
+	struct pollfd pfd = { fd, POLLIN, 0 };
+	char buf[4096];
+	ssize_t ret;
+
+	if (poll(&pfd, 1, timeout_ms) <= 0)
+		return false;
+	ret = read(fd, buf, sizeof(buf));
+	if (ret <= 0)
+		return false;
+	data.append(buf, ret);
+	return true;
+}
+
+/*
+ * Connects to the server and, as a request is taken into account only
+ * once the server gets to read it, publishes probes till one arrives.
+ * Subscribers connected earlier receive those probes too.
+ */
+static int subscribe(log_server &server, const std::string &path, const std::string &request,
+		     uint32_t lib_id)
+{
+	struct sockaddr_un addr = {};
+	struct text_chunk chunk;
+	struct record_ref r = { 0, sizeof(probe) - 1, 0, sizeof(probe) - 1, lib_id };
+	std::string data;
+	int fd;
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path.c_str());
+	if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+	    write(fd, request.data(), request.size()) != (ssize_t)request.size()) {
+		CHECK(!"subscriber failed to connect");
+		return fd;
+	}
+
+	chunk.text = probe;
+	chunk.raw = probe;
+	chunk.records.push_back(r);
+	chunk.last = false;
+	for (int i = 0; i < 500 && data.empty(); i++) {
+		server.publish(chunk);
+		receive(fd, data, 10);
+	}
+	CHECK(data.find(probe) == 0);
+	return fd;
+}
+
+// Returns the stream received by the subscriber, probes stripped off.
+static std::string receive_all(int fd, size_t size)
+{
+	std::string data;
+	size_t pos = 0;
+
+	while (receive(fd, data, 2000)) {
+		while (!data.compare(pos, sizeof(probe) - 1, probe))
+			pos += sizeof(probe) - 1;
+		if (data.size() - pos >= size)
+			break;
+	}
+
+	return data.substr(pos);
+}
+
+int main()
+{
+	std::string csv0 = test_path("lib0.csv");
+	std::string csv1 = test_path("lib1.csv");
+	std::string bin = test_path("trace.bin");
+	std::string raw = test_path("raw.bin");
+	std::string sock = test_path("server.sock");
+	std::vector<detailed_path> paths;
+	dictionary<struct log_literal1_5> dict;
+	struct text_chunk chunk;
+	std::string trace;
+	uint64_t timestamp = 1000;
+
+	test_write(csv0, spt_sites(SITE_COUNT, "lib0 site"));
+	test_write(csv1, spt_sites(SITE_COUNT, "lib1 site"));
+	paths.push_back(detailed_path(csv0, 0));
+	paths.push_back(detailed_path(csv1, 1));
+	build_dictionary(dict, paths);
+
+	spt_records(trace, 1000, SITE_COUNT, 0, timestamp);
+	// sites beyond those of the dictionary
+	for (uint32_t i = 0; i < 20; i++)
+		spt_record(trace, SITE_COUNT + 1 + i % 5, 10, 1, 0, 1, timestamp, 0);
+	spt_records(trace, 1000, SITE_COUNT, 1, timestamp);
+	spt_records(trace, 1000, SITE_COUNT, 0, timestamp);
+	test_write(bin, trace);
+
+	std::string expected = spt_decode(bin, paths);
+
+	decode_chunk(trace, dict, chunk);
+	CHECK(chunk.text == expected);
+	CHECK(expected.find("Unknown record") != std::string::npos);
+
+	{
+		log_server server(sock);
+		int text_fd = subscribe(server, sock, "text\n", 0);
+		int binary_fd = subscribe(server, sock, "binary\n", 0);
+		int lib_fd = subscribe(server, sock, "lib=1\n", 1);
+		std::string known = test_lines(expected, " site ");
+		std::string lib1 = test_lines(expected, "lib1 site");
+
+		CHECK(!lib1.empty() && lib1.size() < known.size());
+		server.publish(chunk);
+
+		// text as decoded, records of other libraries left out on request
+		CHECK(receive_all(text_fd, expected.size()) == expected);
+		CHECK(receive_all(lib_fd, lib1.size()) == lib1);
+
+		// binary stream decodes to the known records
+		test_write(raw, receive_all(binary_fd, chunk.raw.size()));
+		CHECK(spt_decode(raw, paths) == known);
+
+		close(text_fd);
+		close(binary_fd);
+		close(lib_fd);
+	}
+
+	boost::filesystem::remove(csv0);
+	boost::filesystem::remove(csv1);
+	boost::filesystem::remove(bin);
+	boost::filesystem::remove(raw);
+	return test_exit("server_test");
+}
+
+#else
+
+int main()
+{
+	return test_exit("server_test");
+}
+
+#endif
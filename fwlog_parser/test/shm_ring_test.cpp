@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "shm_ring.hpp"
+#include "test.hpp"
+
+#if defined(AVS_HAVE_SHM_RING)
+
+#include <boost/filesystem/operations.hpp>
+#include <algorithm>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define SITE_COUNT	16
+#define RING_PAGES	16
+
+/*
+ * Appends @trace to the window in pieces of varying size, cutting records
+ * in half, while waiting for the consumer so nothing is overrun.
+ */
+static void produce(struct ring_header *hdr, char *data, const std::string &trace)
+{
+	uint64_t head = 0;
+	size_t piece = 1;
+
+	while (head < trace.size()) {
+		size_t len = std::min(trace.size() - head, (size_t)(piece * 36 + 2) * 4);
+
+		while (head + len - __atomic_load_n(&hdr->tail, __ATOMIC_ACQUIRE) > hdr->size)
+			std::this_thread::yield();
+
+		for (size_t i = 0; i < len; i++)
+			data[(head + i) & (hdr->size - 1)] = trace[head + i];
+		head += len;
+		__atomic_store_n(&hdr->head, head, __ATOMIC_RELEASE);
+		piece = piece * 7 % 101;
+	}
+
+	__atomic_fetch_or(&hdr->flags, AVS_RING_FLAG_EOF, __ATOMIC_RELEASE);
+}
+
+int main()
+{
+	std::string csv = test_path("sites.csv");
+	std::string bin = test_path("trace.bin");
+	std::string path = test_path("ring");
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	struct ring_header h = {};
+	std::vector<detailed_path> paths;
+	std::string trace;
+	uint64_t timestamp = 1000;
+	void *map;
+	int fd;
+
+	test_write(csv, spt_sites(SITE_COUNT, "site"));
+	paths.push_back(detailed_path(csv, 0));
+
+	// several times the window, so it wraps mid-record
+	spt_records(trace, 10000, SITE_COUNT, 0, timestamp);
+	for (uint32_t i = 0; i < 50; i++)
+		spt_record(trace, SITE_COUNT + 1 + i % 7, 10, 1, 0, 0, timestamp, i);
+	spt_records(trace, 10000, SITE_COUNT, 0, timestamp);
+	test_write(bin, trace);
+
+	h.magic = AVS_RING_MAGIC;
+	h.data_offset = page;
+	h.size = RING_PAGES * page;
+	test_write(path, std::string((const char *)&h, sizeof(h)));
+	boost::filesystem::resize_file(path, page + h.size);
+
+	fd = open(path.c_str(), O_RDWR);
+	map = mmap(nullptr, page + h.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	CHECK(map != MAP_FAILED);
+
+	{
+		dictionary<struct log_literal1_5> *dict = new dictionary<struct log_literal1_5>();
+		dictionary_slot<struct log_literal1_5> slot(dict);
+		std::ostringstream out;
+		shm_ring ring;
+
+		build_dictionary(*dict, paths);
+		CHECK(ring.open(path, log_entry_spt::max_size()) == 0);
+
+		std::thread producer(produce, (struct ring_header *)map, (char *)map + page,
+				     std::cref(trace));
+
+		CHECK(process_ring<log_entry_spt>(ring, out, slot) == 0);
+		producer.join();
+
+		std::string expected = spt_decode(bin, paths);
+
+		CHECK(trace.size() > 4 * h.size);
+		CHECK(expected.find("Unknown record") != std::string::npos);
+		CHECK(out.str() == expected);
+	}
+
+	munmap(map, page + h.size);
+	boost::filesystem::remove(csv);
+	boost::filesystem::remove(bin);
+	boost::filesystem::remove(path);
+	return test_exit("shm_ring_test");
+}
+
+#else
+
+int main()
+{
+	return test_exit("shm_ring_test");
+}
+
+#endif
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <boost/filesystem/operations.hpp>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "span.hpp"
+#include "test.hpp"
+
+#define SITE_COUNT	8
+
+struct reference_span {
+	reference_span()
+		: unmatched_begins(0), unmatched_ends(0), negative(0)
+	{
+	}
+
+	std::string name;
+	std::string begin; // text logged at the site
+	std::string end;
+	std::map<std::string, uint64_t> open;
+	histogram latency;
+	uint64_t unmatched_begins;
+	uint64_t unmatched_ends;
+	uint64_t negative;
+};
+
+/*
+ * Pairs sites as found in the decoded text, contexts being core and
+ * module instance as printed, and returns the report expected of them.
+ */
+static std::string reference_report(const std::string &text, std::vector<reference_span> &spans)
+{
+	std::istringstream in(text);
+	std::ostringstream out;
+	std::string line;
+
+	while (std::getline(in, line)) {
+		std::istringstream fields(line);
+		std::string core, module, file, level, message;
+		unsigned long long timestamp;
+		char colon;
+
+		if (!(fields >> timestamp >> colon >> core >> module >> file >> level))
+			continue; // unknown record
+		std::getline(fields, message);
+
+		for (auto it = spans.begin(); it != spans.end(); it++) {
+			std::string context = core + " " + module;
+
+			if (!message.compare(0, it->begin.size(), it->begin)) {
+				if (it->open.count(context))
+					it->unmatched_begins++;
+				it->open[context] = timestamp;
+			}
+			if (!message.compare(0, it->end.size(), it->end)) {
+				auto o = it->open.find(context);
+
+				if (o == it->open.end()) {
+					it->unmatched_ends++;
+					continue;
+				}
+				if (timestamp >= o->second)
+					it->latency.add(timestamp - o->second);
+				else
+					it->negative++;
+				it->open.erase(o);
+			}
+		}
+	}
+
+	for (auto it = spans.begin(); it != spans.end(); it++) {
+		out << "span " << it->name << ": " << it->unmatched_begins + it->open.size()
+		    << " unmatched begins, " << it->unmatched_ends << " unmatched ends, "
+		    << it->negative << " negative\n";
+		it->latency.print(out);
+	}
+
+	return out.str();
+}
+
+static struct span_def make_span(const char *begin, const char *end)
+{
+	struct span_def def;
+
+	def.name = std::string(begin) + "," + end;
+	def.begin_lib = 0;
+	def.end_lib = 0;
+	log_entry_spt::parse_key(begin + 2, def.begin_key);
+	log_entry_spt::parse_key(end + 2, def.end_key);
+	return def;
+}
+
+int main()
+{
+	std::string csv = test_path("sites.csv");
+	std::string bin = test_path("trace.bin");
+	std::vector<detailed_path> paths;
+	std::vector<struct span_def> defs;
+	std::vector<reference_span> spans(2);
+	std::string trace;
+	uint64_t timestamp = 1000;
+	uint32_t seed = 1;
+
+	test_write(csv, spt_sites(SITE_COUNT, "site"));
+	paths.push_back(detailed_path(csv, 0));
+
+	// sites 1..3 mostly, contexts interleaved, time going back now and then
+	for (uint32_t i = 0; i < 40000; i++) {
+		uint32_t site, core;
+
+		seed = seed * 1103515245 + 12345;
+		site = (seed >> 16) % 4 + 1;
+		core = (seed >> 8) % 3;
+		timestamp += (seed >> 20) % 50;
+		if ((seed >> 4) % 997 == 0)
+			timestamp -= 400;
+		if (i % 5000 == 7)
+			// unknown to the dictionary
+			spt_record(trace, SITE_COUNT + 1, 10, 1, core, 0, timestamp, i);
+		spt_record(trace, site, 10 * site, (site - 1) % 4 + 1, core, 0, timestamp, i);
+	}
+	test_write(bin, trace);
+
+	// both spans begin at the same site
+	defs.push_back(make_span("0:1:10", "0:2:20"));
+	defs.push_back(make_span("0:1:10", "0:3:30"));
+	for (size_t i = 0; i < defs.size(); i++) {
+		spans[i].name = defs[i].name;
+		spans[i].begin = " site 1 ";
+		spans[i].end = " site " + std::to_string(i + 2) + " ";
+	}
+
+	std::string expected = reference_report(spt_decode(bin, paths), spans);
+
+	{
+		dictionary<struct log_literal1_5> *dict = new dictionary<struct log_literal1_5>();
+		dictionary_slot<struct log_literal1_5> slot(dict);
+		std::unique_ptr<itrace_reader> reader = open_trace_reader(bin);
+		span_tracker<struct log_literal1_5> tracker(defs);
+		std::ostringstream out;
+
+		build_dictionary(*dict, paths);
+		CHECK(trace.size() > 2 * AVS_CHUNK_SIZE);
+		CHECK(span_logdump<log_entry_spt>(*reader, slot, tracker) == 0);
+		tracker.report(out);
+
+		CHECK(spans[0].latency.count() > 1000 && spans[0].negative);
+		CHECK(out.str() == expected);
+	}
+
+	boost::filesystem::remove(csv);
+	boost::filesystem::remove(bin);
+	return test_exit("span_test");
+}
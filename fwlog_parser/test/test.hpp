@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2020-2022, Intel Corporation. All rights reserved.
+ *
+ * Author: Cezary Rojewski <cezary.rojewski@intel.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AVS_TEST_HPP
+#define AVS_TEST_HPP
+
+#include <boost/cstdint.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "dictionary.hpp"
+#include "log_entry_spt.hpp"
+#include "logdump.hpp"
+#include "trace_reader.hpp"
+
+static int test_failures;
+
+#define CHECK(cond)								\
+	do {									\
+		if (!(cond)) {							\
+			std::cerr << __FILE__ << ":" << __LINE__		\
+				  << ": check failed: " #cond << std::endl;	\
+			test_failures++;					\
+		}								\
+	} while (0)
+
+// Returns path of a file unique to this run in the temporary directory.
+static inline std::string test_path(const std::string &name)
+{
+	boost::filesystem::path p = boost::filesystem::temp_directory_path() /
+				    boost::filesystem::unique_path("avsfwlog-%%%%%%-");
+
+	return p.string() + name;
+}
+
+static inline void test_write(const std::string &path, const std::string &data)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+	file.write(data.data(), data.size());
+}
+
+// Appends SPT record of @count payload DWORDs, set to @value onwards.
+static inline void spt_record(std::string &trace, uint32_t file_id, uint32_t line_num,
+			      uint32_t count, uint32_t core, uint32_t lib, uint64_t timestamp,
+			      uint32_t value)
+{
+	uint32_t dw0 = ((count - 1) & 0x3) | line_num << 2 | file_id << 16 | core << 29;
+	uint16_t instance = 0, module = 5 | lib << 12;
+
+	trace.append((const char *)&dw0, sizeof(dw0));
+	trace.append((const char *)&instance, sizeof(instance));
+	trace.append((const char *)&module, sizeof(module));
+	trace.append((const char *)&timestamp, sizeof(timestamp));
+	for (uint32_t i = 0; i < count; i++, value++)
+		trace.append((const char *)&value, sizeof(value));
+}
+
+/*
+ * Returns SPT symbols of @count sites, site i at file_id i + 1 and line
+ * 10 * (i + 1), logging "<prefix> <i + 1>" and then i % 4 + 1 values.
+ */
+static inline std::string spt_sites(uint32_t count, const std::string &prefix)
+{
+	std::string csv;
+
+	for (uint32_t i = 0; i < count; i++) {
+		std::string message = prefix + " " + std::to_string(i + 1);
+
+		for (uint32_t j = 0; j < i % 4 + 1; j++)
+			message += " %u";
+		csv += std::to_string(i + 1) + "," + std::to_string(10 * (i + 1)) + ",\"file" +
+		       std::to_string(i + 1) + ".c\",\"prov\",\"INFO\",\"" + message +
+		       "\",p1,p2,p3,p4\n";
+	}
+
+	return csv;
+}
+
+// Appends @count records of library @lib cycling through spt_sites() sites.
+static inline void spt_records(std::string &trace, uint32_t count, uint32_t sites,
+			       uint32_t lib, uint64_t &timestamp)
+{
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t site = i % sites;
+
+		spt_record(trace, site + 1, 10 * (site + 1), site % 4 + 1, i % 4, lib,
+			   timestamp, i);
+		timestamp += 7;
+	}
+}
+
+// Returns text of the whole trace at @path, decoded the plain way.
+static inline std::string spt_decode(const std::string &path,
+				     const std::vector<detailed_path> &paths)
+{
+	dictionary<struct log_literal1_5> *dict = new dictionary<struct log_literal1_5>();
+	dictionary_slot<struct log_literal1_5> slot(dict);
+	std::unique_ptr<itrace_reader> reader;
+	std::ostringstream out;
+
+	build_dictionary(*dict, paths);
+	reader = open_trace_reader(path);
+	if (process_logdump<log_entry_spt>(*reader, out, slot) < 0)
+		std::cerr << "decode of " << path << " failed" << std::endl;
+	return out.str();
+}
+
+// Returns lines of @text which contain @what.
+static inline std::string test_lines(const std::string &text, const std::string &what)
+{
+	std::istringstream in(text);
+	std::string line, result;
+
+	while (std::getline(in, line))
+		if (line.find(what) != std::string::npos)
+			result += line + "\n";
+	return result;
+}
+
+typedef std::function<bool(uint64_t timestamp, uint32_t core, uint32_t lib,
+			   uint32_t site)> line_filter;
+
+/*
+ * Returns lines of known records of the decoded @text accepted by @filter,
+ * library being 1 for sites of the "lib1 site" prefix and 0 otherwise.
+ */
+static inline std::string spt_filter_lines(const std::string &text, const line_filter &filter)
+{
+	std::istringstream in(text);
+	std::string line, result;
+
+	while (std::getline(in, line)) {
+		std::istringstream fields(line);
+		std::string module, file, level, lib, site;
+		unsigned long long timestamp;
+		uint32_t core, number;
+		char colon;
+
+		if (!(fields >> timestamp >> colon >> core >> module >> file >> level >> lib >>
+		      site >> number))
+			continue; // unknown record
+		if (filter(timestamp, core, lib == "lib1", number))
+			result += line + "\n";
+	}
+
+	return result;
+}
+
+static inline int test_exit(const char *name)
+{
+	std::cerr << name << ": " << (test_failures ? "FAIL" : "PASS") << std::endl;
+	return test_failures ? 1 : 0;
+}
+
+#endif